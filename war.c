@@ -96,378 +96,6570 @@
 // limparBufferEntrada():
 // Função utilitária para limpar o buffer de entrada do teclado (stdin), evitando problemas com leituras consecutivas de scanf e getchar.
 
+// POSIX.1-2008 (mmap, sockets, lstat, mkstemp, strnlen...) também com -std=c11.
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
 #include <time.h> 
+#include <math.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 
 // --- Constantes Globais ---
 #define NOME_MAX 30
 #define COR_MAX 10
 #define MAX_BUFFER 10 
-#define MAX_MISSAO 100 // Tamanho máximo da string de missão
 
-// --- Estrutura de Dados C ---
-struct Territorio {
-    char nome[NOME_MAX];
-    char cor[COR_MAX];
-    int tropas;
-};
+// Padrões do modo de simulação (--simular)
+#define SIM_MAX_TROPAS_PADRAO 10
+#define SIM_BATALHAS_PADRAO 100000
+#define SIM_PARTIDAS_PADRAO 10000
+#define SIM_TERRITORIOS_PADRAO 42
+#define SIM_CORES_PADRAO 4
+#define SIM_MAX_CORES 8
+#define SIM_MAX_RODADAS 1000
+
+// Tabela exata de batalhas (--probabilidades)
+#define PROB_TABELA_INICIAL 16
+#define PROB_MAX_TROPAS 1000 // limite de tropas por lado (a tabela tem (N+1)^2 células)
+
+// Jogadores automáticos (--bots)
+#define BOTS_PARTIDAS_PADRAO 1000
+#define BOTS_POLITICAS_PADRAO "mcts,gulosa"
+#define IA_MAX_ATAQUES 6          // ataques por turno de um bot
+#define IA_MAX_CANDIDATOS 64      // jogadas avaliadas por decisão
+#define IA_CANDIDATOS_MCTS 8      // jogadas (as de maior chance) que o MCTS compara
+#define IA_HORIZONTE 1            // rodadas jogadas em cada rollout do MCTS
+#define IA_ROLLOUTS_PADRAO 64     // rollouts por decisão sem orçamento de tempo
+#define IA_BLOCOS_BUSCA 8         // buscas independentes somadas no fim da decisão
+#define IA_EXPLORACAO 0.7         // constante do UCB1
+#define IA_LIMIAR_GULOSO 0.5      // abaixo desta chance a política gulosa encerra o turno
+#define IA_TABELA_TROPAS 128      // tropas cobertas pela tabela da IA (acima disto, saturada)
+#define IA_VALOR_MAXIMO 1000000   // valor de um rollout vencido (inteiro: soma exata entre threads)
+#define IA_DESFAZER_MINIMO 256    // a partir destes territórios, rollouts são desfeitos pelo registro em vez de copiados
+
+// Partidas com turnos e missões (--turnos)
+#define TURNOS_PARTIDAS_PADRAO 1000
+#define TURNOS_POLITICAS_PADRAO "gulosa,gulosa,gulosa,gulosa"
+
+// Motor paralelo: o trabalho é cortado em blocos de tamanho fixo, cada um com
+// seu próprio fluxo do gerador, para que o resultado não dependa do nº de threads.
+#define BLOCO_BATALHAS 65536
+#define BLOCO_PARTIDAS 16
+#define MAX_THREADS 256
+#define LINHA_CACHE 64
+
+// Quantidade de dados sorteados de uma vez por rolarDados() nos laços de simulação
+#define LOTE_DADOS 256
+
+// Combate: até 3 dados de ataque contra até 2 de defesa, comparados aos pares
+#define DADOS_ATAQUE_MAX 3
+#define DADOS_DEFESA_MAX 2
+
+#define MAX_CORES 255 // Cores distintas por mapa (o id da cor cabe em um byte)
+#define CAMINHO_MAX 256
+
+// Snapshot binário (--carregar / opção 4 do menu)
+#define SNAPSHOT_MAGICA "WARSNAP"
+#define SNAPSHOT_VERSAO 2 // v2: inclui a lista de fronteiras
+#define SNAPSHOT_ALINHAMENTO 8
+
+// Registro de eventos da partida (--gravar / --replay)
+#define REGISTRO_MAGICA "WARLOG"
+#define REGISTRO_VERSAO 1
+#define REPLAY_REPETICOES_PADRAO 1
+
+// Modo servidor (--servidor) e gerador de carga (--carga)
+#define SERVIDOR_SESSOES_PADRAO 1024
+#define SERVIDOR_FILA_CONEXOES 128      // backlog do listen()
+#define SERVIDOR_EVENTOS 64             // eventos tratados por chamada de epoll_wait()
+#define SERVIDOR_ENTRADA 1024           // bytes recebidos e não processados por sessão (limite de uma linha)
+#define SERVIDOR_SAIDA_INICIAL 4096
+#define SERVIDOR_SAIDA_MAX (64 * 1024)  // respostas pendentes a partir das quais a sessão para de ler
+#define SERVIDOR_ARGUMENTOS 4           // palavras de um comando, contando o próprio comando
+#define SERVIDOR_MAX_TERRITORIOS 4096   // por sessão: a memória de uma sessão não cresce sem limite
+#define SERVIDOR_MAX_FRONTEIRAS 16384
+#define CARGA_CONEXOES_PADRAO 32
+#define CARGA_REQUISICOES_PADRAO 10000  // por conexão
+#define CARGA_TERRITORIOS 16            // cadastrados por conexão (fronteiras em cadeia) antes dos ataques
+#define CARGA_TROPAS 1000               // tropas de cada território cadastrado pela carga
+#define CARGA_MAX_TERRITORIOS 256       // por conexão, contando os reforços cadastrados durante a carga
+#define CARGA_PRAZO_MS 5000             // sem nenhuma resposta por este tempo, a carga desiste
+
+// Importação de cenários CSV (--importar)
+#define IMPORTACAO_BLOCO (64 * 1024) // bytes lidos por chamada de read()
+#define IMPORTACAO_MAX_ERROS 20      // erros detalhados na tela; o resto só é contado
+#define CAPACIDADE_INICIAL 16
+#define INDICE_NOMES_INICIAL 64 // entradas do índice de nomes na primeira montagem (potência de 2)
+#define ORDENACAO_INSERCAO_MAX 16 // linhas do grafo até este grau são ordenadas por inserção
+
+// Arena da partida: blocos grandes, liberados todos de uma vez
+#define ARENA_BLOCO (64 * 1024)
+#define ARENA_ALINHAMENTO 16
+
+// Benchmarks (--benchmark)
+#define BENCH_TEMPO_MINIMO 0.2          // segundos por medição (as repetições dobram até passar disto)
+#define BENCH_MAX_REPETICOES (1L << 30)
+#define BENCH_MAX_TERRITORIOS_PADRAO 1000000
+
+// Saída na tela
+#define SAIDA_BLOCO (64 * 1024)  // bytes acumulados antes de cada fwrite()
+#define EXIBICAO_POR_PAGINA 20   // linhas por página na tabela de territórios
+
+// --- Estrutura de Dados C ---
+// Bloco de memória da arena; os blocos formam uma lista ligada.
+struct BlocoArena {
+    struct BlocoArena* proximo;
+    size_t tamanho;
+    size_t usado;
+    unsigned char dados[];
+};
+
+typedef struct BlocoArena BlocoArena;
+
+// Arena: toda alocação de uma partida sai daqui e é devolvida de uma vez em
+// arenaLiberar() (ou reaproveitada com arenaReiniciar() entre partidas simuladas).
+struct Arena {
+    BlocoArena* primeiro;
+    BlocoArena* atual;
+    size_t bytes_reservados;
+    long blocos;
+};
+
+typedef struct Arena Arena;
+
+// Cores internadas: cada nome de cor vira um id pequeno, e a posse de um
+// território passa a ser comparada como inteiro em vez de strcmp.
+struct TabelaCores {
+    char nomes[MAX_CORES][COR_MAX];
+    int total;
+};
+
+typedef struct TabelaCores TabelaCores;
+
+// Estado anterior de um território, guardado no registro de desfazer.
+struct AlteracaoMapa {
+    int id;
+    int tropas;
+    int posicao;       // lugar em ordem_por_cor, para desfazer a troca de dono exatamente
+    uint8_t dono;
+};
+
+typedef struct AlteracaoMapa AlteracaoMapa;
+
+// Entrada do índice de nomes: o hash evita strcmp nas colisões; id -1 = vazia.
+struct EntradaIndiceNomes {
+    uint32_t hash;
+    int id;
+};
+
+typedef struct EntradaIndiceNomes EntradaIndiceNomes;
+
+// Área de trabalho de maiorRegiao(), do tamanho da capacidade do mapa: visitado
+// é "visita[id] == geracao", então cada busca só toca os territórios que visita
+// (sem zerar nem alocar nada). Fica fora do Mapa para que a verificação de
+// missão continue recebendo const Mapa*.
+struct RascunhoRegioes {
+    uint32_t geracao;
+    uint32_t* visita;
+    int* fila;
+};
+
+typedef struct RascunhoRegioes RascunhoRegioes;
+
+// Mapa em "estrutura de vetores": os campos quentes (dono e tropas) ficam em
+// vetores contíguos e os nomes, lidos só na exibição, numa tabela separada.
+struct Mapa {
+    Arena* arena;              // de onde vêm os vetores (e o próprio Mapa)
+    int total;                 // territórios cadastrados; o id é o índice e nunca muda
+    int capacidade;            // territórios que cabem nos vetores (cresce sob demanda)
+    uint8_t* dono;             // id da cor que domina cada território
+    int* tropas;               // tropas de cada território
+    char (*nomes)[NOME_MAX];   // nomes (dados frios)
+    TabelaCores cores;
+
+    // Fronteiras como foram cadastradas (pares de ids) e o grafo CSR derivado delas:
+    // os vizinhos de i ficam em grafo_vizinhos[grafo_inicio[i] .. grafo_inicio[i+1]),
+    // em ordem crescente. Sem nenhuma fronteira, o mapa não tem geografia e
+    // qualquer território pode atacar qualquer outro.
+    int (*fronteiras)[2];
+    long total_fronteiras;
+    long capacidade_fronteiras;
+    int* grafo_inicio;
+    int* grafo_vizinhos;
+    int capacidade_grafo_inicio;    // posições reservadas nos vetores do grafo, reaproveitados
+    long capacidade_grafo_vizinhos; // a cada reconstrução (0 = ainda não são deste mapa)
+    int grafo_territorios;     // territórios cobertos pelo grafo construído
+    int grafo_valido;          // 0 quando há fronteira ou território novo desde a construção
+
+    // Quando carregado de um snapshot, os vetores acima apontam para este mapeamento.
+    void* mapeamento;
+    size_t tamanho_mapeamento;
+
+    // Agregados mantidos a cada cadastro/ataque, para que a verificação de
+    // missão seja uma consulta O(1) em vez de uma varredura do mapa.
+    int territorios_por_cor[MAX_CORES];
+    long long tropas_por_cor[MAX_CORES];
+    long long tropas_total;
+
+    // Territórios agrupados por dono, mantidos a cada cadastro e troca de dono: os
+    // da cor c ficam em ordem_por_cor[inicio_cor[c] .. inicio_cor[c] + territorios_por_cor[c])
+    // (em ordem qualquer), e posicao_na_ordem[id] diz onde cada um está. Quem só
+    // quer os territórios de uma cor não precisa varrer o mapa.
+    int* ordem_por_cor;
+    int* posicao_na_ordem;
+    int inicio_cor[MAX_CORES];
+
+    // Índice nome -> id (endereçamento aberto, sondagem linear, no máximo meio
+    // cheio). Montado sob demanda por buscarTerritorio(), que indexa os cadastros
+    // novos antes de consultar: cobre os ids [0, nomes_indexados).
+    EntradaIndiceNomes* indice_nomes;
+    int capacidade_indice;     // potência de 2; 0 = ainda não montado
+    int nomes_indexados;
+
+    RascunhoRegioes* rascunho; // de maiorRegiao(); cada mapa (e cada cópia) tem o seu
+
+    // Registro de desfazer (desligado por padrão): com ele ativo, alterarTropas() e
+    // trocarDono() guardam o estado anterior do território, e desfazerAte() volta
+    // o mapa em O(alterações) em vez de copiar os vetores inteiros.
+    AlteracaoMapa* desfazer;
+    long total_desfazer;
+    long capacidade_desfazer;
+    int registrando;
+    int desfazer_incompleto;   // faltou memória para alguma entrada: não dá para voltar
+};
+
+typedef struct Mapa Mapa;
+
+// Texto montado em memória e entregue ao stdio em blocos grandes (um fwrite()
+// por bloco em vez de um printf() por campo). Reutilizável: descarregarSaida()
+// só zera o uso.
+struct SaidaBuffer {
+    FILE* destino;
+    size_t usado;
+    char dados[SAIDA_BLOCO];
+};
+
+typedef struct SaidaBuffer SaidaBuffer;
+
+// Filtro e paginação da tabela compacta de territórios.
+struct FiltroTerritorios {
+    int cor;            // id da cor, ou -1 para todas
+    int tropas_minimas;
+    long pagina;        // a partir de 1
+    int por_pagina;     // 0: tudo em uma página
+};
+
+typedef struct FiltroTerritorios FiltroTerritorios;
+
+// Contadores da sessão (--instrumentar / --trace), somados nos caminhos quentes.
+enum ContadorSessao {
+    CONTADOR_ATAQUES,             // rodadas jogadas por atacar()
+    CONTADOR_ATAQUES_RELAMPAGO,   // batalhas de atacarAteConquistar()
+    CONTADOR_CONQUISTAS,
+    CONTADOR_VARREDURAS_MAPA,     // passadas por todos os territórios (tela, grafo, regiões)
+    CONTADOR_TERRITORIOS_VARRIDOS,
+    CONTADOR_TERRITORIOS_CADASTRADOS,
+    CONTADOR_BYTES_ESCRITOS,      // tela (descarregarSaida) e snapshots
+    CONTADOR_BYTES_LIDOS,         // snapshots e cenários
+    TOTAL_CONTADORES
+};
+
+typedef enum ContadorSessao ContadorSessao;
+
+// Intervalos medidos: um por função instrumentada.
+enum IntervaloSessao {
+    INTERVALO_INICIAR_ATAQUE,
+    INTERVALO_ATACAR,
+    INTERVALO_ATACAR_ATE_CONQUISTAR,
+    INTERVALO_VERIFICAR_MISSAO,
+    INTERVALO_CADASTRAR_TERRITORIO,
+    INTERVALO_DESCARREGAR_SAIDA,
+    INTERVALO_SALVAR_SNAPSHOT,
+    INTERVALO_CARREGAR_SNAPSHOT,
+    INTERVALO_IMPORTAR_CENARIO,
+    TOTAL_INTERVALOS
+};
+
+typedef enum IntervaloSessao IntervaloSessao;
+
+struct EstatisticaIntervalo {
+    long long chamadas;
+    uint64_t ns_total;
+    uint64_t ns_maximo;
+};
+
+typedef struct EstatisticaIntervalo EstatisticaIntervalo;
+
+// Estado da instrumentação (um só por processo). Desligada, cada ponto
+// instrumentado custa um desvio; ligada, só a thread principal a usa.
+struct Instrumentacao {
+    int ativa;
+    uint64_t inicio_ns;
+    long long contadores[TOTAL_CONTADORES];
+    EstatisticaIntervalo intervalos[TOTAL_INTERVALOS];
+    SaidaBuffer* trace;   // eventos no formato Trace Event (JSON), ou NULL
+    long long eventos;
+};
+
+typedef struct Instrumentacao Instrumentacao;
+
+// Eventos do registro da partida (--gravar). Cada evento é um byte de tipo seguido
+// dos campos em varint (LEB128); textos levam o tamanho na frente.
+enum TipoEvento {
+    EVENTO_GERADOR = 1, // estado do gerador (4 palavras) no início da gravação
+    EVENTO_TERRITORIO,  // nome, cor, tropas
+    EVENTO_FRONTEIRA,   // id a, id b
+    EVENTO_MISSAO,      // índice no catálogo do menu
+    EVENTO_RODADA,      // atacante, defensor, quantidades de dados (1 byte) e faces (2 bytes, 3 bits cada)
+    EVENTO_RELAMPAGO,   // atacante, defensor, tropas finais dos dois
+    EVENTO_FIM,         // hash do estado final (8 bytes) e missão cumprida (1 byte)
+    TOTAL_EVENTOS
+};
+
+typedef enum TipoEvento TipoEvento;
+
+// Gravação em andamento (uma por processo; saida == NULL: desligada).
+struct RegistroEventos {
+    SaidaBuffer* saida;
+    const char* caminho;
+    long long eventos;
+};
+
+typedef struct RegistroEventos RegistroEventos;
+
+// Tipos de missão: cada um tem uma regra própria em verificarMissao().
+enum TipoMissao {
+    MISSAO_POSSUIR_TERRITORIOS,  // possuir pelo menos 'quantidade' territórios
+    MISSAO_ELIMINAR_COR,         // nenhum território da cor 'parametro' no mapa
+    MISSAO_TOTAL_TROPAS,         // ter mais de 'quantidade' tropas
+    MISSAO_POSSUIR_TERRITORIO,   // dominar o território chamado 'parametro'
+    MISSAO_MAIORIA_TERRITORIOS,  // ter mais territórios que qualquer outra cor
+    TOTAL_TIPOS_MISSAO
+};
+
+typedef enum TipoMissao TipoMissao;
+
+// Missão como aparece no catálogo (texto + parâmetros).
+struct DefinicaoMissao {
+    TipoMissao tipo;
+    const char* descricao;
+    int quantidade;
+    const char* parametro;
+};
+
+typedef struct DefinicaoMissao DefinicaoMissao;
+
+// Missão sorteada e já resolvida para o mapa: nomes viram ids uma única vez.
+struct Missao {
+    int indice;                      // posição no catálogo (para salvar/carregar)
+    int cor;                         // cor do dono da missão (-1: a do primeiro território, jogo de um jogador)
+    TipoMissao tipo;
+    const char* descricao;
+    int quantidade;
+    int cor_alvo;                    // MISSAO_ELIMINAR_COR
+    char territorio_alvo[NOME_MAX];  // MISSAO_POSSUIR_TERRITORIO
+    int id_territorio_alvo;          // -1 enquanto o território não for cadastrado
+};
+
+typedef struct Missao Missao;
+
+// Cabeçalho do snapshot. Todos os campos têm tamanho fixo; os vetores do mapa
+// vêm logo depois, alinhados, para serem usados direto do mmap.
+struct CabecalhoSnapshot {
+    char magica[8];
+    uint32_t versao;
+    uint32_t tamanho_cabecalho;
+    uint64_t tamanho_arquivo;
+
+    int32_t total;
+    int32_t total_cores;
+    uint64_t deslocamento_tropas;
+    uint64_t deslocamento_dono;
+    uint64_t deslocamento_nomes;
+    int64_t total_fronteiras;
+    uint64_t deslocamento_fronteiras;
+
+    char nomes_cores[MAX_CORES][COR_MAX];
+    int32_t territorios_por_cor[MAX_CORES];
+    int64_t tropas_por_cor[MAX_CORES];
+    int64_t tropas_total;
+
+    int32_t missao_indice;
+    int32_t missao_tipo;
+    int32_t missao_quantidade;
+    int32_t missao_cor_alvo;
+    int32_t missao_id_territorio_alvo;
+    char missao_territorio_alvo[NOME_MAX];
+
+    uint64_t estado_gerador[4];
+};
+
+typedef struct CabecalhoSnapshot CabecalhoSnapshot;
+
+// Resultado de importarCenario().
+struct EstatisticasImportacao {
+    long linhas;
+    long importados;
+    long fronteiras;
+    long erros;
+    long long bytes;
+    double segundos;
+};
+
+typedef struct EstatisticasImportacao EstatisticasImportacao;
+
+// Resultado exato de uma batalha completa (o atacante repete até conquistar ou ficar com 1 tropa).
+struct ResultadoBatalha {
+    double vitoria;           // probabilidade de conquistar o território
+    double perdas_atacante;   // tropas perdidas pelo atacante, em média
+    double perdas_defensor;   // tropas perdidas pelo defensor, em média
+};
+
+typedef struct ResultadoBatalha ResultadoBatalha;
+
+// Tabela memorizada de ResultadoBatalha para 0..max_ataque x 0..max_defesa,
+// estendida sob demanda por consultarBatalha().
+struct TabelaBatalhas {
+    int max_ataque;
+    int max_defesa;
+    ResultadoBatalha* celulas; // celulas[a * (max_defesa + 1) + d]
+};
+
+typedef struct TabelaBatalhas TabelaBatalhas;
+
+// Políticas dos jogadores automáticos.
+enum TipoPolitica {
+    POLITICA_ALEATORIA,  // ataque sorteado entre os possíveis
+    POLITICA_GULOSA,     // maior chance exata de conquista (tabela de batalhas)
+    POLITICA_MCTS        // busca Monte Carlo com rollouts em cópias do mapa
+};
+
+typedef enum TipoPolitica TipoPolitica;
+
+// Um ataque escolhido por um jogador automático.
+struct Jogada {
+    int atacante;
+    int defensor;
+};
+
+typedef struct Jogada Jogada;
+
+// Jogador automático: política + orçamento de busca.
+struct JogadorIA {
+    TipoPolitica politica;
+    double tempo_jogada;           // segundos por decisão do MCTS (0: usa max_rollouts)
+    long max_rollouts;             // rollouts por decisão do MCTS
+    int threads;                   // threads da busca
+    const TabelaBatalhas* tabela;  // já calculada; só é lida (várias threads)
+};
+
+typedef struct JogadorIA JogadorIA;
+
+// Gerador xoshiro256** com estado explícito: cada laço/thread usa o seu próprio,
+// identificado por (semente, fluxo), sem estado global escondido como rand().
+struct GeradorAleatorio {
+    uint64_t estado[4];
+};
+
+typedef struct GeradorAleatorio GeradorAleatorio;
+
+// Reserva de dados já sorteados, consumida um a um pelos laços de simulação.
+struct LoteDados {
+    GeradorAleatorio* gerador;
+    int dados[LOTE_DADOS];
+    int posicao;
+};
+
+typedef struct LoteDados LoteDados;
+
+// Uma rodada de combate: os dados de cada lado (em ordem decrescente, depois de
+// comparados) e as tropas que cada lado perdeu.
+struct RodadaCombate {
+    int num_ataque;                      // tropas do atacante - 1, no máximo 3
+    int num_defesa;                      // tropas do defensor, no máximo 2
+    int dados_ataque[DADOS_ATAQUE_MAX];
+    int dados_defesa[DADOS_DEFESA_MAX];
+    int perdas_atacante;
+    int perdas_defensor;
+};
+
+typedef struct RodadaCombate RodadaCombate;
+
+// Fases de um turno, na ordem em que o motor as executa.
+enum FaseTurno {
+    FASE_REFORCO,
+    FASE_ATAQUE,
+    FASE_FORTIFICACAO,
+    TOTAL_FASES
+};
+
+typedef enum FaseTurno FaseTurno;
+
+// Participante de uma partida com turnos.
+struct Jogador {
+    int cor;             // id da cor no mapa
+    Missao missao;       // sorteada para este jogador (atribuirMissao() com a sua cor)
+    JogadorIA controle;  // política que decide reforços, ataques e fortificação
+};
+
+typedef struct Jogador Jogador;
+
+// Partida em andamento: avancarFase() executa uma fase do jogador da vez por chamada.
+struct Partida {
+    Mapa* mapa;
+    Jogador* jogadores;
+    int num_jogadores;
+    int vez;             // índice do jogador da vez
+    FaseTurno fase;
+    int rodada;
+    int vencedor;        // índice do jogador que cumpriu a missão (-1: ninguém ainda)
+    LoteDados* lote;
+    long long ataques;
+    long long fortificacoes;
+};
+
+typedef struct Partida Partida;
+
+// Tarefa executada pelo motor para um bloco: escreve somente no acumulador da própria thread.
+typedef void (*FuncaoBloco)(long bloco, GeradorAleatorio* gerador, void* acumulador, const void* contexto);
+// Soma o acumulador 'origem' em 'destino' (somas inteiras: a ordem não altera o resultado).
+typedef void (*FuncaoMesclar)(void* destino, const void* origem, const void* contexto);
+
+struct MotorParalelo {
+    long total_blocos;
+    atomic_long proximo_bloco;
+    uint64_t semente;
+    FuncaoBloco executar;
+    const void* contexto;
+    unsigned char* acumuladores; // um por thread, alinhados à linha de cache
+    size_t passo_acumulador;
+};
+
+typedef struct MotorParalelo MotorParalelo;
+
+// Acumulador de uma trabalhadora no modo --simular-partidas.
+struct ResultadoPartidas {
+    long long vitorias[SIM_MAX_CORES];
+    long long sem_vencedor;
+    long long rodadas;
+    long long ataques;
+};
+
+typedef struct ResultadoPartidas ResultadoPartidas;
+
+// Contadores de alocações no heap, somados pelos embrulhos de alocar() e lidos
+// por --benchmark. Atômicos relaxados: as threads do motor também alocam.
+static atomic_long alocacoes_heap;
+static atomic_llong bytes_heap;
+
+static Instrumentacao instrumentacao;
+static RegistroEventos registro;
+
+// --- Protótipos das Funções ---
+// Funções de Alocação
+void* alocar(size_t tamanho);
+void* alocarZerado(size_t quantidade, size_t tamanho);
+void* realocar(void* memoria, size_t tamanho);
+void* alocarAlinhado(size_t alinhamento, size_t tamanho);
+
+// Funções do Gerador Aleatório
+void iniciarGerador(GeradorAleatorio* gerador, uint64_t semente, uint64_t fluxo);
+uint64_t proximoAleatorio(GeradorAleatorio* gerador);
+uint32_t sortearLimitado(GeradorAleatorio* gerador, uint32_t limite);
+void rolarDados(GeradorAleatorio* gerador, int* destino, int quantidade);
+void iniciarLoteDados(LoteDados* lote, GeradorAleatorio* gerador);
+int proximoDado(LoteDados* lote);
+
+// Funções da Arena
+void iniciarArena(Arena* arena);
+void* arenaAlocar(Arena* arena, size_t tamanho);
+void arenaReiniciar(Arena* arena);
+void arenaLiberar(Arena* arena);
+
+void limparBufferEntrada();
+void iniciarSaida(SaidaBuffer* saida, FILE* destino);
+void anexarTexto(SaidaBuffer* saida, const char* texto);
+void anexarColuna(SaidaBuffer* saida, const char* texto, int largura);
+void anexarInteiro(SaidaBuffer* saida, long long valor, int largura);
+void anexarFormatado(SaidaBuffer* saida, const char* formato, ...) __attribute__((format(printf, 2, 3)));
+void descarregarSaida(SaidaBuffer* saida);
+
+// Funções da Instrumentação
+int iniciarInstrumentacao(const char* caminho_trace);
+void registrarIntervalo(IntervaloSessao intervalo, uint64_t inicio_ns);
+void encerrarInstrumentacao();
+
+Mapa* criarMapa(Arena* arena, int capacidade);
+int garantirCapacidade(Mapa* mapa, int minimo);
+void limparMapa(Mapa* mapa);
+Mapa* alocarMapa(Arena* arena);
+void liberarMemoria(Mapa* mapa, Arena* arena); // Atualizada
+int internarCor(Mapa* mapa, const char* nome_cor);
+int buscarCor(const Mapa* mapa, const char* nome_cor);
+const char* nomeDaCor(const Mapa* mapa, int cor);
+int adicionarTerritorio(Mapa* mapa, const char* nome, const char* nome_cor, int tropas);
+int buscarTerritorio(Mapa* mapa, const char* nome);
+int cadastrarTerritorio(Mapa* mapa);
+void exibirTerritorios(const Mapa* mapa);
+void exibirTabelaTerritorios(const Mapa* mapa, const FiltroTerritorios* filtro, SaidaBuffer* saida);
+void consultarTerritorios(const Mapa* mapa);
+
+// Funções de Fronteiras (grafo)
+int adicionarFronteira(Mapa* mapa, int a, int b);
+int atualizarGrafo(Mapa* mapa);
+int saoVizinhos(const Mapa* mapa, int a, int b);
+int maiorRegiao(const Mapa* mapa, int cor, int limite);
+void cadastrarFronteira(Mapa* mapa);
+void exibirRegioes(Mapa* mapa);
+
+// Funções de Missão
+void compilarMissao(Missao* destino, const DefinicaoMissao missoes[], int indice, Mapa* mapa, int cor);
+void atribuirMissao(Missao* destino, const DefinicaoMissao missoes[], int totalMissoes, Mapa* mapa, int cor,
+                    GeradorAleatorio* gerador);
+void vincularTerritorioMissao(Missao* missao, const Mapa* mapa, int id);
+int corDoJogador(const Mapa* mapa);
+int verificarMissao(const Missao* missao, const Mapa* mapa);
+void exibirMissao(const Missao* missao);
+
+// Funções de Ataque
+int rolarDado(GeradorAleatorio* gerador);
+void rolarRodada(RodadaCombate* rodada, int tropas_atacante, int tropas_defensor, GeradorAleatorio* gerador);
+void rolarRodadaLote(RodadaCombate* rodada, int tropas_atacante, int tropas_defensor, LoteDados* lote);
+int resolverCombate(int *tropas_atacante, int *tropas_defensor, const RodadaCombate* rodada);
+int batalhaRelampago(int *tropas_atacante, int *tropas_defensor, LoteDados* lote);
+void alterarTropas(Mapa* mapa, int id, int delta);
+void trocarDono(Mapa* mapa, int id, int nova_cor);
+void ativarDesfazer(Mapa* mapa);
+long marcarDesfazer(const Mapa* mapa);
+int desfazerAte(Mapa* mapa, long marca);
+void desativarDesfazer(Mapa* mapa);
+int aplicarCombate(Mapa* mapa, int id_atacante, int id_defensor, const RodadaCombate* rodada);
+int aplicarBatalha(Mapa* mapa, int id_atacante, int id_defensor, LoteDados* lote);
+void atacar(Mapa* mapa, int id_atacante, int id_defensor, GeradorAleatorio* gerador, SaidaBuffer* relatorio);
+void atacarAteConquistar(Mapa* mapa, int id_atacante, int id_defensor, GeradorAleatorio* gerador, SaidaBuffer* relatorio);
+void iniciarAtaque(Mapa* mapa, const Missao* missao_do_jogador, int *jogo_vencido, GeradorAleatorio* gerador,
+                   SaidaBuffer* relatorio);
+
+// Funções de Snapshot
+int salvarSnapshot(const char* caminho, const Mapa* mapa, const Missao* missao, const GeradorAleatorio* gerador);
+Mapa* carregarSnapshot(const char* caminho, Arena* arena, Missao* missao, GeradorAleatorio* gerador);
+void salvarJogo(const Mapa* mapa, const Missao* missao, const GeradorAleatorio* gerador);
+
+// Funções de Importação
+int importarCenario(const char* caminho, Mapa* mapa, EstatisticasImportacao* estatisticas);
+
+// Funções do Registro de Eventos e Replay
+uint64_t hashEstado(const Mapa* mapa, const GeradorAleatorio* gerador);
+int iniciarRegistro(const char* caminho, uint64_t semente);
+void registrarEstadoInicial(const Mapa* mapa, const Missao* missao, const GeradorAleatorio* gerador);
+void registrarTerritorio(const Mapa* mapa, int id);
+void registrarFronteira(int a, int b);
+void registrarRodada(int id_atacante, int id_defensor, const RodadaCombate* rodada);
+void registrarRelampago(const Mapa* mapa, int id_atacante, int id_defensor);
+void encerrarRegistro(const Mapa* mapa, const Missao* missao, const GeradorAleatorio* gerador);
+int executarReplay(const char* caminho, long repeticoes);
+
+// Funções do Modo Servidor
+int executarServidor(const char* endereco, int max_sessoes, uint64_t semente);
+int executarCarga(const char* endereco, int num_conexoes, long requisicoes, uint64_t semente);
+
+// Funções do Modo de Simulação
+double tempoAtualSegundos();
+int numeroDeNucleos();
+int executarEmParalelo(long total_blocos, int num_threads, uint64_t semente, FuncaoBloco executar, FuncaoMesclar mesclar,
+                       const void* contexto, void* resultado, size_t tamanho_acumulador);
+int simularBatalha(int tropas_atacante, int tropas_defensor, LoteDados* lote);
+int simularPartida(Mapa* mapa, int num_territorios, int num_cores, LoteDados* lote, ResultadoPartidas* resultado);
+int executarSimulacao(int max_ataque, int max_defesa, long batalhas_por_celula, uint64_t semente, int num_threads);
+int executarSimulacaoPartidas(long partidas, int num_territorios, int num_cores, uint64_t semente, int num_threads);
+
+// Funções de Probabilidades Exatas
+void iniciarTabelaBatalhas(TabelaBatalhas* tabela);
+int garantirTabelaBatalhas(TabelaBatalhas* tabela, int max_ataque, int max_defesa);
+const ResultadoBatalha* consultarBatalha(TabelaBatalhas* tabela, int tropas_atacante, int tropas_defensor);
+void liberarTabelaBatalhas(TabelaBatalhas* tabela);
+int executarProbabilidades(int max_ataque, int max_defesa);
+
+// Funções dos Jogadores Automáticos
+Mapa* clonarMapa(Arena* arena, const Mapa* origem);
+void copiarEstadoMapa(Mapa* destino, const Mapa* origem);
+int listarJogadas(const Mapa* mapa, int cor, const TabelaBatalhas* tabela, Jogada* jogadas, int max);
+void reforcarCor(Mapa* mapa, int cor, TipoPolitica politica, GeradorAleatorio* gerador);
+int escolherJogada(const JogadorIA* jogador, const Mapa* mapa, int cor, int ataques_restantes, GeradorAleatorio* gerador, Jogada* jogada);
+int jogarPartidaBots(Mapa* mapa, const JogadorIA jogadores[], int num_cores, LoteDados* lote, ResultadoPartidas* resultado);
+int executarPartidasBots(long partidas, int num_territorios, const char* politicas, double tempo_jogada, long max_rollouts,
+                         uint64_t semente, int num_threads);
+
+// Funções do Motor de Turnos
+int fortificarCor(Mapa* mapa, int cor, TipoPolitica politica);
+void iniciarPartida(Partida* partida, Mapa* mapa, Jogador jogadores[], int num_jogadores, const DefinicaoMissao missoes[],
+                    int total_missoes, LoteDados* lote);
+int avancarFase(Partida* partida);
+int jogarPartida(Partida* partida);
+int executarPartidasTurnos(long partidas, int num_territorios, const char* politicas, double tempo_jogada,
+                           long max_rollouts, uint64_t semente, int num_threads);
+
+// Funções de Benchmark
+int executarBenchmarks(const char* formato, int max_territorios, uint64_t semente);
+
+// --- Implementação das Funções ---
+
+/**
+ * @brief malloc() com contagem (alocacoes_heap / bytes_heap).
+ */
+void* alocar(size_t tamanho) {
+    atomic_fetch_add_explicit(&alocacoes_heap, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&bytes_heap, (long long)tamanho, memory_order_relaxed);
+    return malloc(tamanho);
+}
+
+/**
+ * @brief calloc() com contagem.
+ */
+void* alocarZerado(size_t quantidade, size_t tamanho) {
+    atomic_fetch_add_explicit(&alocacoes_heap, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&bytes_heap, (long long)(quantidade * tamanho), memory_order_relaxed);
+    return calloc(quantidade, tamanho);
+}
+
+/**
+ * @brief realloc() com contagem (cada crescimento conta como uma alocação).
+ */
+void* realocar(void* memoria, size_t tamanho) {
+    atomic_fetch_add_explicit(&alocacoes_heap, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&bytes_heap, (long long)tamanho, memory_order_relaxed);
+    return realloc(memoria, tamanho);
+}
+
+/**
+ * @brief aligned_alloc() com contagem.
+ */
+void* alocarAlinhado(size_t alinhamento, size_t tamanho) {
+    atomic_fetch_add_explicit(&alocacoes_heap, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&bytes_heap, (long long)tamanho, memory_order_relaxed);
+    return aligned_alloc(alinhamento, tamanho);
+}
+
+/**
+ * @brief Passo do splitmix64, usado apenas para espalhar a semente no estado do xoshiro.
+ */
+static uint64_t misturarSemente(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Inicializa o gerador a partir de uma semente e de um identificador de fluxo.
+ * Fluxos diferentes com a mesma semente produzem sequências independentes.
+ */
+void iniciarGerador(GeradorAleatorio* gerador, uint64_t semente, uint64_t fluxo) {
+    uint64_t x = semente;
+    uint64_t desvio = fluxo;
+    x ^= misturarSemente(&desvio);
+    for (int i = 0; i < 4; i++) {
+        gerador->estado[i] = misturarSemente(&x);
+    }
+}
+
+static inline uint64_t rotacionar(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+/**
+ * @brief Próximo valor de 64 bits do xoshiro256**.
+ */
+uint64_t proximoAleatorio(GeradorAleatorio* gerador) {
+    uint64_t *s = gerador->estado;
+    uint64_t resultado = rotacionar(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotacionar(s[3], 45);
+
+    return resultado;
+}
+
+/**
+ * @brief Converte 32 bits aleatórios em um valor em [0, limite) sem viés
+ * (multiplicação de Lemire com rejeição). Retorna 1 se o valor foi aceito.
+ */
+static inline int reduzirSemVies(uint32_t bits, uint32_t limite, uint32_t *saida) {
+    uint64_t m = (uint64_t)bits * limite;
+    uint32_t resto = (uint32_t)m;
+    if (resto < limite && resto < (uint32_t)(-limite) % limite) {
+        return 0;
+    }
+    *saida = (uint32_t)(m >> 32);
+    return 1;
+}
+
+/**
+ * @brief Sorteia um inteiro uniforme em [0, limite) sem o viés de rand() % N.
+ */
+uint32_t sortearLimitado(GeradorAleatorio* gerador, uint32_t limite) {
+    uint32_t valor;
+    while (!reduzirSemVies((uint32_t)(proximoAleatorio(gerador) >> 32), limite, &valor));
+    return valor;
+}
+
+/**
+ * @brief Produto completo 64x64 -> 128 bits: devolve a metade alta e guarda a baixa.
+ * Usa o inteiro de 128 bits do compilador quando existe (GCC/Clang) e, fora
+ * disso, monta o produto com quatro multiplicações de 32 bits.
+ */
+static inline uint64_t multiplicar128(uint64_t a, uint64_t b, uint64_t* baixo) {
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef unsigned __int128 Produto128;
+    Produto128 m = (Produto128)a * b;
+    *baixo = (uint64_t)m;
+    return (uint64_t)(m >> 64);
+#else
+    uint64_t a_baixo = (uint32_t)a, a_alto = a >> 32;
+    uint64_t b_baixo = (uint32_t)b, b_alto = b >> 32;
+    uint64_t bb = a_baixo * b_baixo;
+    uint64_t ab = a_alto * b_baixo;
+    uint64_t ba = a_baixo * b_alto;
+    uint64_t aa = a_alto * b_alto;
+    uint64_t meio = (bb >> 32) + (uint32_t)ab + (uint32_t)ba;
+    *baixo = (meio << 32) | (uint32_t)bb;
+    return aa + (ab >> 32) + (ba >> 32) + (meio >> 32);
+#endif
+}
+
+/**
+ * @brief Versão de 64 bits de sortearLimitado() (Lemire com produto de 128 bits).
+ */
+static uint64_t sortearLimitado64(GeradorAleatorio* gerador, uint64_t limite) {
+    uint64_t baixo;
+    uint64_t alto = multiplicar128(proximoAleatorio(gerador), limite, &baixo);
+    if (baixo < limite) {
+        uint64_t minimo = (0 - limite) % limite;
+        while (baixo < minimo) {
+            alto = multiplicar128(proximoAleatorio(gerador), limite, &baixo);
+        }
+    }
+    return alto;
+}
+
+/**
+ * @brief Rola 'quantidade' dados de 6 faces no buffer destino.
+ * Aproveita as duas metades de cada sorteio de 64 bits.
+ */
+void rolarDados(GeradorAleatorio* gerador, int* destino, int quantidade) {
+    int i = 0;
+    while (i < quantidade) {
+        uint64_t bits = proximoAleatorio(gerador);
+        uint32_t valor;
+        if (reduzirSemVies((uint32_t)(bits >> 32), 6, &valor)) {
+            destino[i++] = (int)valor + 1;
+        }
+        if (i < quantidade && reduzirSemVies((uint32_t)bits, 6, &valor)) {
+            destino[i++] = (int)valor + 1;
+        }
+    }
+}
+
+/**
+ * @brief Prepara um lote vazio; ele é preenchido na primeira chamada de proximoDado().
+ */
+void iniciarLoteDados(LoteDados* lote, GeradorAleatorio* gerador) {
+    lote->gerador = gerador;
+    lote->posicao = LOTE_DADOS;
+}
+
+/**
+ * @brief Consome um dado do lote, sorteando um novo lote quando ele acaba.
+ */
+int proximoDado(LoteDados* lote) {
+    if (lote->posicao == LOTE_DADOS) {
+        rolarDados(lote->gerador, lote->dados, LOTE_DADOS);
+        lote->posicao = 0;
+    }
+    return lote->dados[lote->posicao++];
+}
+
+/**
+ * @brief Prepara uma arena vazia (o primeiro bloco só é pedido na primeira alocação).
+ */
+void iniciarArena(Arena* arena) {
+    arena->primeiro = NULL;
+    arena->atual = NULL;
+    arena->bytes_reservados = 0;
+    arena->blocos = 0;
+}
+
+/**
+ * @brief Reserva 'tamanho' bytes zerados na arena, alinhados a ARENA_ALINHAMENTO.
+ * Reaproveita blocos de uma rodada anterior (após arenaReiniciar) antes de pedir novos.
+ * @return Ponteiro para a memória ou NULL se faltar memória.
+ */
+void* arenaAlocar(Arena* arena, size_t tamanho) {
+    tamanho = (tamanho + ARENA_ALINHAMENTO - 1) / ARENA_ALINHAMENTO * ARENA_ALINHAMENTO;
+
+    while (arena->atual != NULL && arena->atual->tamanho - arena->atual->usado < tamanho) {
+        if (arena->atual->proximo == NULL) break;
+        arena->atual = arena->atual->proximo;
+    }
+
+    BlocoArena* bloco = arena->atual;
+    if (bloco == NULL || bloco->tamanho - bloco->usado < tamanho) {
+        size_t tamanho_bloco = (tamanho > ARENA_BLOCO) ? tamanho : ARENA_BLOCO;
+        BlocoArena* novo = (BlocoArena*)alocarAlinhado(ARENA_ALINHAMENTO,
+            (sizeof(BlocoArena) + tamanho_bloco + ARENA_ALINHAMENTO - 1) / ARENA_ALINHAMENTO * ARENA_ALINHAMENTO);
+        if (novo == NULL) return NULL;
+        novo->proximo = NULL;
+        novo->tamanho = tamanho_bloco;
+        novo->usado = 0;
+        if (bloco == NULL) {
+            arena->primeiro = novo;
+        } else {
+            novo->proximo = bloco->proximo;
+            bloco->proximo = novo;
+        }
+        arena->atual = novo;
+        arena->bytes_reservados += tamanho_bloco;
+        arena->blocos++;
+        bloco = novo;
+    }
+
+    void* memoria = bloco->dados + bloco->usado;
+    bloco->usado += tamanho;
+    memset(memoria, 0, tamanho);
+    return memoria;
+}
+
+/**
+ * @brief Esquece tudo o que foi alocado, mas mantém os blocos para a próxima partida.
+ */
+void arenaReiniciar(Arena* arena) {
+    for (BlocoArena* bloco = arena->primeiro; bloco != NULL; bloco = bloco->proximo) {
+        bloco->usado = 0;
+    }
+    arena->atual = arena->primeiro;
+}
+
+/**
+ * @brief Devolve todos os blocos ao sistema.
+ */
+void arenaLiberar(Arena* arena) {
+    BlocoArena* bloco = arena->primeiro;
+    while (bloco != NULL) {
+        BlocoArena* proximo = bloco->proximo;
+        free(bloco);
+        bloco = proximo;
+    }
+    iniciarArena(arena);
+}
+
+/**
+ * @brief Limpa o buffer de entrada do teclado (stdin).
+ */
+void limparBufferEntrada() {
+    int c;
+    while ((c = getchar()) != '\n' && c != EOF);
+}
+
+// --- Instrumentação da Sessão (--instrumentar / --trace) ---
+
+static const char* NOMES_CONTADORES[TOTAL_CONTADORES] = {
+    "ataques", "ataques_relampago", "conquistas", "varreduras_mapa", "territorios_varridos",
+    "territorios_cadastrados", "bytes_escritos", "bytes_lidos"
+};
+
+static const char* NOMES_INTERVALOS[TOTAL_INTERVALOS] = {
+    "iniciarAtaque", "atacar", "atacarAteConquistar", "verificarMissao", "cadastrarTerritorio",
+    "descarregarSaida", "salvarSnapshot", "carregarSnapshot", "importarCenario"
+};
+
+static uint64_t relogioNanossegundos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline void contar(ContadorSessao contador, long long quantidade) {
+    if (instrumentacao.ativa) instrumentacao.contadores[contador] += quantidade;
+}
+
+/**
+ * @brief Marca o início de um intervalo; desligada, nem lê o relógio.
+ */
+static inline uint64_t iniciarIntervalo() {
+    return instrumentacao.ativa ? relogioNanossegundos() : 0;
+}
+
+static inline void encerrarIntervalo(IntervaloSessao intervalo, uint64_t inicio_ns) {
+    if (instrumentacao.ativa) registrarIntervalo(intervalo, inicio_ns);
+}
+
+/**
+ * @brief Liga a instrumentação. Com caminho_trace, cada intervalo vira também um
+ * evento "X" do formato Trace Event (abre no Perfetto ou em chrome://tracing).
+ * @return 0 em caso de sucesso, -1 se o arquivo do trace não pôde ser criado.
+ */
+int iniciarInstrumentacao(const char* caminho_trace) {
+    memset(&instrumentacao, 0, sizeof(instrumentacao));
+    if (caminho_trace != NULL) {
+        FILE* arquivo = fopen(caminho_trace, "w");
+        if (arquivo == NULL) return -1;
+        instrumentacao.trace = (SaidaBuffer*)alocar(sizeof(SaidaBuffer));
+        if (instrumentacao.trace == NULL) {
+            fclose(arquivo);
+            return -1;
+        }
+        iniciarSaida(instrumentacao.trace, arquivo);
+        anexarTexto(instrumentacao.trace, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    }
+    instrumentacao.inicio_ns = relogioNanossegundos();
+    instrumentacao.ativa = 1;
+    return 0;
+}
+
+/**
+ * @brief Fecha um intervalo aberto por iniciarIntervalo(): soma nas estatísticas
+ * e, com trace, anexa o evento (em microssegundos desde o início da sessão).
+ */
+void registrarIntervalo(IntervaloSessao intervalo, uint64_t inicio_ns) {
+    uint64_t fim_ns = relogioNanossegundos();
+    uint64_t duracao = fim_ns - inicio_ns;
+    EstatisticaIntervalo* estatistica = &instrumentacao.intervalos[intervalo];
+    estatistica->chamadas++;
+    estatistica->ns_total += duracao;
+    if (duracao > estatistica->ns_maximo) estatistica->ns_maximo = duracao;
+
+    if (instrumentacao.trace != NULL) {
+        anexarFormatado(instrumentacao.trace,
+                        "%s{\"name\":\"%s\",\"cat\":\"war\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}",
+                        instrumentacao.eventos > 0 ? ",\n" : "", NOMES_INTERVALOS[intervalo],
+                        (double)(inicio_ns - instrumentacao.inicio_ns) / 1000.0, (double)duracao / 1000.0);
+        instrumentacao.eventos++;
+    }
+}
+
+/**
+ * @brief Desliga a instrumentação e imprime os contadores e os intervalos da
+ * sessão; com trace, fecha o arquivo (os contadores entram como evento "C").
+ */
+void encerrarInstrumentacao() {
+    if (!instrumentacao.ativa) return;
+    instrumentacao.ativa = 0;
+
+    printf("\n--- Instrumentação da sessão ---\n");
+    for (int c = 0; c < TOTAL_CONTADORES; c++) {
+        printf("%-24s %12lld\n", NOMES_CONTADORES[c], instrumentacao.contadores[c]);
+    }
+    printf("\n%-22s %10s %12s %12s %12s\n", "intervalo", "chamadas", "total_ms", "media_us", "maximo_us");
+    for (int i = 0; i < TOTAL_INTERVALOS; i++) {
+        const EstatisticaIntervalo* estatistica = &instrumentacao.intervalos[i];
+        if (estatistica->chamadas == 0) continue;
+        printf("%-22s %10lld %12.3f %12.3f %12.3f\n", NOMES_INTERVALOS[i], estatistica->chamadas,
+               (double)estatistica->ns_total / 1e6, (double)estatistica->ns_total / 1e3 / (double)estatistica->chamadas,
+               (double)estatistica->ns_maximo / 1e3);
+    }
+
+    SaidaBuffer* trace = instrumentacao.trace;
+    if (trace != NULL) {
+        anexarFormatado(trace, "%s{\"name\":\"contadores\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":1,\"args\":{",
+                        instrumentacao.eventos > 0 ? ",\n" : "",
+                        (double)(relogioNanossegundos() - instrumentacao.inicio_ns) / 1000.0);
+        for (int c = 0; c < TOTAL_CONTADORES; c++) {
+            anexarFormatado(trace, "%s\"%s\":%lld", c > 0 ? "," : "", NOMES_CONTADORES[c], instrumentacao.contadores[c]);
+        }
+        anexarTexto(trace, "}}\n]}\n");
+        descarregarSaida(trace);
+        if (fclose(trace->destino) != 0) perror("Erro ao gravar o trace");
+        free(trace);
+        instrumentacao.trace = NULL;
+    }
+}
+
+// --- Saída em Buffer ---
+
+void iniciarSaida(SaidaBuffer* saida, FILE* destino) {
+    saida->destino = destino;
+    saida->usado = 0;
+}
+
+/**
+ * @brief Entrega o texto acumulado ao stdio e esvazia o buffer. Passar pelo
+ * FILE mantém a ordem com os printf() e o buffer do próprio stdio: na tela o
+ * bloco sai em um write(), redirecionado ele só é copiado.
+ */
+void descarregarSaida(SaidaBuffer* saida) {
+    if (saida->usado > 0) {
+        // O buffer do trace não se mede (cada medida anexaria mais um evento nele).
+        int medir = (saida != instrumentacao.trace);
+        uint64_t inicio = medir ? iniciarIntervalo() : 0;
+        fwrite(saida->dados, 1, saida->usado, saida->destino);
+        if (medir) {
+            contar(CONTADOR_BYTES_ESCRITOS, (long long)saida->usado);
+            encerrarIntervalo(INTERVALO_DESCARREGAR_SAIDA, inicio);
+        }
+    }
+    saida->usado = 0;
+}
+
+static void anexarBytes(SaidaBuffer* saida, const char* bytes, size_t tamanho) {
+    while (tamanho > 0) {
+        if (saida->usado == SAIDA_BLOCO) descarregarSaida(saida);
+        size_t parte = SAIDA_BLOCO - saida->usado;
+        if (parte > tamanho) parte = tamanho;
+        memcpy(saida->dados + saida->usado, bytes, parte);
+        saida->usado += parte;
+        bytes += parte;
+        tamanho -= parte;
+    }
+}
+
+static void anexarEspacos(SaidaBuffer* saida, int quantidade) {
+    static const char ESPACOS[] = "                                ";
+    while (quantidade > 0) {
+        int parte = quantidade < (int)sizeof(ESPACOS) - 1 ? quantidade : (int)sizeof(ESPACOS) - 1;
+        anexarBytes(saida, ESPACOS, (size_t)parte);
+        quantidade -= parte;
+    }
+}
+
+void anexarTexto(SaidaBuffer* saida, const char* texto) {
+    anexarBytes(saida, texto, strlen(texto));
+}
+
+/**
+ * @brief Anexa o texto alinhado à esquerda em uma coluna de `largura` bytes (como "%-*s").
+ */
+void anexarColuna(SaidaBuffer* saida, const char* texto, int largura) {
+    size_t tamanho = strlen(texto);
+    anexarBytes(saida, texto, tamanho);
+    anexarEspacos(saida, largura - (int)tamanho);
+}
+
+/**
+ * @brief Anexa um inteiro alinhado à direita em `largura` colunas (como "%*lld"),
+ * sem passar pelo interpretador de formato do printf.
+ */
+void anexarInteiro(SaidaBuffer* saida, long long valor, int largura) {
+    char digitos[24];
+    int inicio = (int)sizeof(digitos);
+    unsigned long long absoluto = valor < 0 ? 0ULL - (unsigned long long)valor : (unsigned long long)valor;
+    do {
+        digitos[--inicio] = (char)('0' + absoluto % 10);
+        absoluto /= 10;
+    } while (absoluto > 0);
+    if (valor < 0) digitos[--inicio] = '-';
+
+    int tamanho = (int)sizeof(digitos) - inicio;
+    anexarEspacos(saida, largura - tamanho);
+    anexarBytes(saida, digitos + inicio, (size_t)tamanho);
+}
+
+/**
+ * @brief Anexa texto formatado (printf). Para linhas raras; nos laços, prefira
+ * anexarTexto()/anexarInteiro(). Linhas maiores que SAIDA_BLOCO são truncadas.
+ */
+void anexarFormatado(SaidaBuffer* saida, const char* formato, ...) {
+    for (int tentativa = 0; tentativa < 2; tentativa++) {
+        size_t livre = SAIDA_BLOCO - saida->usado;
+        va_list argumentos;
+        va_start(argumentos, formato);
+        int n = vsnprintf(saida->dados + saida->usado, livre, formato, argumentos);
+        va_end(argumentos);
+        if (n < 0) return;
+        if ((size_t)n < livre) {
+            saida->usado += (size_t)n;
+            return;
+        }
+        if (tentativa == 0 && saida->usado > 0) {
+            descarregarSaida(saida); // não coube: esvazia e formata de novo
+        } else {
+            saida->usado = SAIDA_BLOCO - 1;
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Se o mapa ainda usa um snapshot mapeado, copia territórios e fronteiras
+ * para a arena e desfaz o mapeamento (antes de qualquer vetor crescer).
+ * @return 0 em caso de sucesso, -1 se faltar memória (o mapa continua mapeado).
+ */
+static int desvincularSnapshot(Mapa* mapa) {
+    if (mapa->mapeamento == NULL) return 0;
+
+    size_t n = (size_t)mapa->total;
+    size_t f = (size_t)mapa->total_fronteiras;
+    uint8_t* dono = (uint8_t*)arenaAlocar(mapa->arena, n * sizeof(uint8_t));
+    int* tropas = (int*)arenaAlocar(mapa->arena, n * sizeof(int));
+    char (*nomes)[NOME_MAX] = (char (*)[NOME_MAX])arenaAlocar(mapa->arena, n * NOME_MAX);
+    int (*fronteiras)[2] = (int (*)[2])arenaAlocar(mapa->arena, f * sizeof(int[2]));
+    if (dono == NULL || tropas == NULL || nomes == NULL || fronteiras == NULL) return -1;
+
+    memcpy(dono, mapa->dono, n * sizeof(uint8_t));
+    memcpy(tropas, mapa->tropas, n * sizeof(int));
+    memcpy(nomes, mapa->nomes, n * NOME_MAX);
+    memcpy(fronteiras, mapa->fronteiras, f * sizeof(int[2]));
+    munmap(mapa->mapeamento, mapa->tamanho_mapeamento);
+
+    mapa->mapeamento = NULL;
+    mapa->dono = dono;
+    mapa->tropas = tropas;
+    mapa->nomes = nomes;
+    mapa->fronteiras = fronteiras;
+    mapa->capacidade = mapa->total;
+    mapa->capacidade_fronteiras = mapa->total_fronteiras;
+    return 0;
+}
+
+/**
+ * @brief Cria um mapa vazio na arena, com espaço inicial para 'capacidade' territórios.
+ * @return Ponteiro para o mapa ou NULL se faltar memória.
+ */
+Mapa* criarMapa(Arena* arena, int capacidade) {
+    Mapa* mapa = (Mapa*)arenaAlocar(arena, sizeof(Mapa));
+    if (mapa == NULL) return NULL;
+
+    mapa->arena = arena;
+    if (garantirCapacidade(mapa, capacidade) != 0) return NULL;
+    return mapa;
+}
+
+/**
+ * @brief Dá ao rascunho de maiorRegiao() espaço para 'capacidade' territórios.
+ * Os carimbos novos vêm zerados e a geração continua: ninguém fica marcado.
+ * @return 0 em caso de sucesso, -1 se faltar memória.
+ */
+static int prepararRascunho(Mapa* mapa, int capacidade) {
+    size_t n = (size_t)(capacidade > 0 ? capacidade : 1);
+    RascunhoRegioes* rascunho = mapa->rascunho;
+    if (rascunho == NULL) {
+        rascunho = (RascunhoRegioes*)arenaAlocar(mapa->arena, sizeof(RascunhoRegioes));
+        if (rascunho == NULL) return -1;
+        rascunho->geracao = 1;
+    }
+    uint32_t* visita = (uint32_t*)arenaAlocar(mapa->arena, n * sizeof(uint32_t));
+    int* fila = (int*)arenaAlocar(mapa->arena, n * sizeof(int));
+    if (visita == NULL || fila == NULL) return -1;
+    rascunho->visita = visita;
+    rascunho->fila = fila;
+    mapa->rascunho = rascunho;
+    return 0;
+}
+
+/**
+ * @brief Garante espaço para pelo menos 'minimo' territórios, dobrando a capacidade.
+ * Os vetores novos vêm da arena e os antigos ficam para trás até a arena ser
+ * liberada (no máximo o mesmo tanto que a capacidade atual). Os ids não mudam.
+ * @return 0 em caso de sucesso, -1 se faltar memória (o mapa continua válido).
+ */
+int garantirCapacidade(Mapa* mapa, int minimo) {
+    if (minimo <= mapa->capacidade) return 0;
+    if (desvincularSnapshot(mapa) != 0) return -1;
+
+    int nova = (mapa->capacidade > 0) ? mapa->capacidade : CAPACIDADE_INICIAL;
+    while (nova < minimo) {
+        nova = (nova > INT32_MAX / 2) ? minimo : nova * 2;
+    }
+
+    uint8_t* dono = (uint8_t*)arenaAlocar(mapa->arena, (size_t)nova * sizeof(uint8_t));
+    int* tropas = (int*)arenaAlocar(mapa->arena, (size_t)nova * sizeof(int));
+    char (*nomes)[NOME_MAX] = (char (*)[NOME_MAX])arenaAlocar(mapa->arena, (size_t)nova * NOME_MAX);
+    int* ordem = (int*)arenaAlocar(mapa->arena, (size_t)nova * sizeof(int));
+    int* posicao = (int*)arenaAlocar(mapa->arena, (size_t)nova * sizeof(int));
+    if (dono == NULL || tropas == NULL || nomes == NULL || ordem == NULL || posicao == NULL) return -1;
+    if (prepararRascunho(mapa, nova) != 0) return -1;
+
+    if (mapa->total > 0) {
+        memcpy(dono, mapa->dono, (size_t)mapa->total * sizeof(uint8_t));
+        memcpy(tropas, mapa->tropas, (size_t)mapa->total * sizeof(int));
+        memcpy(nomes, mapa->nomes, (size_t)mapa->total * NOME_MAX);
+        memcpy(ordem, mapa->ordem_por_cor, (size_t)mapa->total * sizeof(int));
+        memcpy(posicao, mapa->posicao_na_ordem, (size_t)mapa->total * sizeof(int));
+    }
+    mapa->dono = dono;
+    mapa->tropas = tropas;
+    mapa->nomes = nomes;
+    mapa->ordem_por_cor = ordem;
+    mapa->posicao_na_ordem = posicao;
+    mapa->capacidade = nova;
+    return 0;
+}
+
+/**
+ * @brief Esvazia o mapa (territórios, cores e agregados), mantendo os vetores alocados.
+ */
+void limparMapa(Mapa* mapa) {
+    mapa->total = 0;
+    mapa->cores.total = 0;
+    memset(mapa->territorios_por_cor, 0, sizeof(mapa->territorios_por_cor));
+    memset(mapa->tropas_por_cor, 0, sizeof(mapa->tropas_por_cor));
+    mapa->tropas_total = 0;
+    mapa->total_fronteiras = 0;
+    mapa->grafo_valido = 0;
+    if (mapa->capacidade_indice > 0) {
+        memset(mapa->indice_nomes, 0xff, (size_t)mapa->capacidade_indice * sizeof(EntradaIndiceNomes));
+    }
+    mapa->nomes_indexados = 0;
+}
+
+/**
+ * @brief Cria o mapa da partida. A capacidade cresce sozinha, então não há
+ * mais um máximo a perguntar ao jogador.
+ */
+Mapa* alocarMapa(Arena* arena) {
+    Mapa* mapa = criarMapa(arena, CAPACIDADE_INICIAL);
+    if (mapa == NULL) {
+        perror("Erro na alocação do mapa");
+        exit(EXIT_FAILURE);
+    }
+    return mapa;
+}
+
+/**
+ * @brief Libera de uma vez toda a memória da partida (Mapa, Missão e o que mais
+ * tiver vindo da arena), além do snapshot mapeado, se houver.
+ * @param mapa Ponteiro para o mapa (pode ser NULL).
+ * @param arena Arena da partida.
+ */
+void liberarMemoria(Mapa* mapa, Arena* arena) {
+    if (mapa != NULL && mapa->mapeamento != NULL) {
+        munmap(mapa->mapeamento, mapa->tamanho_mapeamento);
+        mapa->mapeamento = NULL;
+    }
+    if (arena->blocos > 0) {
+        printf("\nMemória da partida liberada (%zu bytes em %ld blocos).\n", arena->bytes_reservados, arena->blocos);
+    }
+    arenaLiberar(arena);
+}
+
+/**
+ * @brief Procura uma cor já internada.
+ * @return Id da cor ou -1 se ela ainda não existe no mapa.
+ */
+int buscarCor(const Mapa* mapa, const char* nome_cor) {
+    for (int c = 0; c < mapa->cores.total; c++) {
+        if (strcmp(mapa->cores.nomes[c], nome_cor) == 0) {
+            return c;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Retorna o id da cor, registrando-a na tabela se for nova.
+ * É o único ponto que compara nomes de cores; o resto do jogo usa os ids.
+ * @return Id da cor ou -1 se a tabela de cores estiver cheia.
+ */
+int internarCor(Mapa* mapa, const char* nome_cor) {
+    int cor = buscarCor(mapa, nome_cor);
+    if (cor >= 0) return cor;
+
+    if (mapa->cores.total >= MAX_CORES) return -1;
+    cor = mapa->cores.total++;
+    snprintf(mapa->cores.nomes[cor], COR_MAX, "%s", nome_cor);
+    mapa->inicio_cor[cor] = mapa->total; // segmento vazio no fim de ordem_por_cor
+    return cor;
+}
+
+/**
+ * @brief Nome legível de uma cor internada.
+ */
+const char* nomeDaCor(const Mapa* mapa, int cor) {
+    return mapa->cores.nomes[cor];
+}
+
+/**
+ * @brief Troca duas posições de ordem_por_cor, mantendo posicao_na_ordem.
+ */
+static inline void trocarNaOrdem(Mapa* mapa, int p, int q) {
+    int a = mapa->ordem_por_cor[p];
+    int b = mapa->ordem_por_cor[q];
+    mapa->ordem_por_cor[p] = b;
+    mapa->ordem_por_cor[q] = a;
+    mapa->posicao_na_ordem[a] = q;
+    mapa->posicao_na_ordem[b] = p;
+}
+
+/**
+ * @brief Leva o território do segmento da cor 'de' para o da cor 'para' em
+ * ordem_por_cor. Cada segmento no caminho cede a ponta de um lado e ganha a do
+ * outro, então custa uma troca por cor entre as duas (sem alocar nada). Os
+ * contadores territorios_por_cor ainda devem ser os de antes da mudança.
+ */
+static void moverNaOrdem(Mapa* mapa, int id, int de, int para) {
+    int* inicio = mapa->inicio_cor;
+    const int* quantidade = mapa->territorios_por_cor;
+    if (de < para) {
+        // Vai para o fim do próprio segmento e então, segmento a segmento, entra
+        // como o primeiro e troca de lugar com o último.
+        trocarNaOrdem(mapa, mapa->posicao_na_ordem[id], inicio[de] + quantidade[de] - 1);
+        for (int c = de + 1; c < para; c++) {
+            inicio[c]--;
+            trocarNaOrdem(mapa, inicio[c], inicio[c] + quantidade[c]);
+        }
+        inicio[para]--;
+    } else if (de > para) {
+        // O caminho inverso: entra como o último e troca de lugar com o primeiro.
+        trocarNaOrdem(mapa, mapa->posicao_na_ordem[id], inicio[de]);
+        inicio[de]++;
+        for (int c = de - 1; c > para; c--) {
+            trocarNaOrdem(mapa, inicio[c] + quantidade[c], inicio[c]);
+            inicio[c]++;
+        }
+    }
+}
+
+/**
+ * @brief Remonta ordem_por_cor a partir de dono (contagem por cor), para quando
+ * os donos foram escritos direto nos vetores (snapshot, redistribuição).
+ * @return 0 se as contagens batem com territorios_por_cor, -1 caso contrário.
+ */
+static int reconstruirOrdemPorCor(Mapa* mapa) {
+    int proximo[MAX_CORES];
+    long inicio = 0;
+    int consistente = 1;
+    for (int c = 0; c < mapa->cores.total; c++) {
+        if (mapa->territorios_por_cor[c] < 0 || inicio + mapa->territorios_por_cor[c] > mapa->total) return -1;
+        mapa->inicio_cor[c] = proximo[c] = (int)inicio;
+        inicio += mapa->territorios_por_cor[c];
+    }
+    if (inicio != mapa->total) return -1;
+
+    for (int i = 0; i < mapa->total && consistente; i++) {
+        int c = mapa->dono[i];
+        consistente = proximo[c] < mapa->inicio_cor[c] + mapa->territorios_por_cor[c];
+        if (consistente) {
+            mapa->ordem_por_cor[proximo[c]] = i;
+            mapa->posicao_na_ordem[i] = proximo[c]++;
+        }
+    }
+    return consistente ? 0 : -1;
+}
+
+/**
+ * @brief Territórios da cor, em ordem qualquer; são territorios_por_cor[cor] ids.
+ */
+static inline const int* territoriosDaCor(const Mapa* mapa, int cor) {
+    return mapa->ordem_por_cor + mapa->inicio_cor[cor];
+}
+
+/**
+ * @brief Acrescenta um território ao mapa sem prompts.
+ * @return Id do novo território, ou -1 se o mapa ou a tabela de cores estiver cheio.
+ */
+int adicionarTerritorio(Mapa* mapa, const char* nome, const char* nome_cor, int tropas) {
+    if (mapa->total >= mapa->capacidade) return -1;
+
+    int cor = internarCor(mapa, nome_cor);
+    if (cor < 0) return -1;
+
+    int id = mapa->total++;
+    snprintf(mapa->nomes[id], NOME_MAX, "%s", nome);
+    mapa->dono[id] = (uint8_t)cor;
+    mapa->tropas[id] = tropas;
+
+    // Entra no fim de ordem_por_cor e recua até o fim do segmento da sua cor.
+    int posicao = id;
+    mapa->ordem_por_cor[posicao] = id;
+    mapa->posicao_na_ordem[id] = posicao;
+    for (int c = mapa->cores.total - 1; c > cor; c--) {
+        trocarNaOrdem(mapa, posicao, mapa->inicio_cor[c]);
+        posicao = mapa->inicio_cor[c]++;
+    }
+
+    mapa->territorios_por_cor[cor]++;
+    mapa->tropas_por_cor[cor] += tropas;
+    mapa->tropas_total += tropas;
+    mapa->grafo_valido = 0;
+    return id;
+}
+
+/**
+ * @brief FNV-1a de 32 bits do nome (chave do índice de nomes).
+ */
+static uint32_t hashNome(const char* nome) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)nome; *p != 0; p++) {
+        hash = (hash ^ *p) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Põe o território no índice de nomes. Com nomes repetidos, fica o
+ * primeiro id (o mesmo que uma busca linear acharia).
+ */
+static void indexarNome(Mapa* mapa, int id) {
+    uint32_t hash = hashNome(mapa->nomes[id]);
+    uint32_t mascara = (uint32_t)mapa->capacidade_indice - 1;
+    for (uint32_t k = hash & mascara;; k = (k + 1) & mascara) {
+        EntradaIndiceNomes* entrada = &mapa->indice_nomes[k];
+        if (entrada->id < 0) {
+            entrada->hash = hash;
+            entrada->id = id;
+            return;
+        }
+        if (entrada->hash == hash && strcmp(mapa->nomes[entrada->id], mapa->nomes[id]) == 0) return;
+    }
+}
+
+/**
+ * @brief Indexa os territórios cadastrados desde a última consulta. Passando de
+ * meia carga, monta uma tabela com o dobro do tamanho (da arena) e reindexa tudo.
+ * @return 0 em caso de sucesso, -1 se faltar memória (o índice antigo continua válido).
+ */
+static int atualizarIndiceNomes(Mapa* mapa) {
+    if (mapa->nomes_indexados == mapa->total) return 0;
+
+    if ((long)mapa->total * 2 > mapa->capacidade_indice) {
+        long nova = (mapa->capacidade_indice > 0) ? mapa->capacidade_indice : INDICE_NOMES_INICIAL;
+        while (nova < (long)mapa->total * 2) nova *= 2;
+        EntradaIndiceNomes* tabela = (EntradaIndiceNomes*)arenaAlocar(mapa->arena, (size_t)nova * sizeof(EntradaIndiceNomes));
+        if (tabela == NULL) return -1;
+        memset(tabela, 0xff, (size_t)nova * sizeof(EntradaIndiceNomes));
+        mapa->indice_nomes = tabela;
+        mapa->capacidade_indice = (int)nova;
+        mapa->nomes_indexados = 0;
+    }
+    for (; mapa->nomes_indexados < mapa->total; mapa->nomes_indexados++) {
+        indexarNome(mapa, mapa->nomes_indexados);
+    }
+    return 0;
+}
+
+/**
+ * @brief Procura um território pelo nome exato em O(1) (índice de nomes).
+ * Sem memória para o índice, cai para a busca linear.
+ * @return Id do primeiro território com esse nome, ou -1 se não houver.
+ */
+int buscarTerritorio(Mapa* mapa, const char* nome) {
+    if (atualizarIndiceNomes(mapa) != 0) {
+        for (int i = 0; i < mapa->total; i++) {
+            if (strcmp(mapa->nomes[i], nome) == 0) return i;
+        }
+        return -1;
+    }
+    if (mapa->capacidade_indice == 0) return -1;
+
+    uint32_t hash = hashNome(nome);
+    uint32_t mascara = (uint32_t)mapa->capacidade_indice - 1;
+    for (uint32_t k = hash & mascara;; k = (k + 1) & mascara) {
+        const EntradaIndiceNomes* entrada = &mapa->indice_nomes[k];
+        if (entrada->id < 0) return -1;
+        if (entrada->hash == hash && strcmp(mapa->nomes[entrada->id], nome) == 0) return entrada->id;
+    }
+}
+
+static int lerTerritorio(Mapa* mapa) {
+    printf("\n--- Cadastro de Território ---\n");
+    int id = -1;
+    
+    if(garantirCapacidade(mapa, mapa->total + 1) == 0) {
+        
+        char temp_str[MAX_BUFFER]; 
+        char cor[COR_MAX];
+        char nome[NOME_MAX];
+        int tropas;
+
+        // Leitura segura da Cor e Nome
+        printf("Digite a cor da tropa (Ex: Azul): ");
+        if (fgets(cor, COR_MAX, stdin) == NULL) cor[0] = 0;
+        cor[strcspn(cor, "\n")] = 0; 
+
+        printf("Digite o nome do teritório (Ex: Brasil): ");
+        if (fgets(nome, NOME_MAX, stdin) == NULL) nome[0] = 0;
+        nome[strcspn(nome, "\n")] = 0; 
+
+        // Leitura segura das Tropas
+        printf("Digite a quantidade de tropas (Mín. 1): ");
+        if (fgets(temp_str, MAX_BUFFER, stdin) != NULL && sscanf(temp_str, "%d", &tropas) == 1 && tropas >= 1) {
+            id = adicionarTerritorio(mapa, nome, cor, tropas);
+            if (id >= 0) {
+                printf("\n** Território '%s' registrado com sucesso! **\n", nome);
+            } else {
+                printf("\n** ERRO: Limite de %d cores diferentes atingido. **\n", MAX_CORES);
+            }
+        } else {
+            printf("\n** ERRO: Quantidade de tropas inválida (Deve ser um número inteiro >= 1). **\n");
+        }
+        
+    } else {
+        printf("\n** ERRO: Memória insuficiente para um novo território. **\n");
+    }
+    return id;
+}
+
+/**
+ * @brief Cadastra um novo território no mapa.
+ * @return Id do território cadastrado ou -1 se o cadastro falhou.
+ */
+int cadastrarTerritorio(Mapa* mapa) {
+    uint64_t inicio = iniciarIntervalo();
+    int id = lerTerritorio(mapa);
+    contar(CONTADOR_TERRITORIOS_CADASTRADOS, id >= 0);
+    encerrarIntervalo(INTERVALO_CADASTRAR_TERRITORIO, inicio);
+    return id;
+}
+
+/**
+ * @brief Exibe todos os territórios cadastrados (montados no buffer e enviados em blocos).
+ */
+void exibirTerritorios(const Mapa* mapa) {
+    SaidaBuffer saida;
+    iniciarSaida(&saida, stdout);
+    anexarTexto(&saida, "\n--- Lista de Territórios/Tropas ---\n");
+
+    if(mapa->total == 0) {
+        anexarTexto(&saida, "Nenhum território/tropa foi cadastrado.\n");
+    } else {
+        contar(CONTADOR_VARREDURAS_MAPA, 1);
+        contar(CONTADOR_TERRITORIOS_VARRIDOS, mapa->total);
+        for(int i = 0; i < mapa->total; i++) {
+            anexarTexto(&saida, "=================================================\nID: ");
+            anexarInteiro(&saida, i, 0);
+            anexarTexto(&saida, "\nNome: ");
+            anexarTexto(&saida, mapa->nomes[i]);
+            anexarTexto(&saida, "\nCor: ");
+            anexarTexto(&saida, nomeDaCor(mapa, mapa->dono[i]));
+            anexarTexto(&saida, "\nTropas: ");
+            anexarInteiro(&saida, mapa->tropas[i], 0);
+            anexarTexto(&saida, "\n");
+        }
+        anexarTexto(&saida, "=================================================\n");
+    }
+    descarregarSaida(&saida);
+}
+
+/**
+ * @brief Tabela compacta (uma linha por território) com filtro por cor e tropas
+ * mínimas e paginação. Uma única varredura: conta os que passam no filtro e só
+ * formata os da página pedida.
+ */
+void exibirTabelaTerritorios(const Mapa* mapa, const FiltroTerritorios* filtro, SaidaBuffer* saida) {
+    long pular = (filtro->por_pagina > 0 && filtro->pagina > 1) ? (filtro->pagina - 1) * filtro->por_pagina : 0;
+    long limite = filtro->por_pagina > 0 ? filtro->por_pagina : LONG_MAX;
+
+    anexarTexto(saida, "\n--- Tabela de Territórios ---\n");
+    anexarTexto(saida, "     ID | Nome                          | Cor       | Tropas\n");
+    anexarTexto(saida, "--------+-------------------------------+-----------+-------\n");
+
+    long encontrados = 0;
+    // Cor sem territórios: nada a varrer (contagem mantida pelos agregados).
+    int possivel = (filtro->cor < 0) || (filtro->cor < mapa->cores.total && mapa->territorios_por_cor[filtro->cor] > 0);
+    if (possivel) {
+        contar(CONTADOR_VARREDURAS_MAPA, 1);
+        contar(CONTADOR_TERRITORIOS_VARRIDOS, mapa->total);
+    }
+    for (int i = 0; possivel && i < mapa->total; i++) {
+        if (filtro->cor >= 0 && mapa->dono[i] != filtro->cor) continue;
+        if (mapa->tropas[i] < filtro->tropas_minimas) continue;
+        if (encontrados >= pular && encontrados - pular < limite) {
+            anexarInteiro(saida, i, 7);
+            anexarTexto(saida, " | ");
+            anexarColuna(saida, mapa->nomes[i], NOME_MAX - 1);
+            anexarTexto(saida, " | ");
+            anexarColuna(saida, nomeDaCor(mapa, mapa->dono[i]), COR_MAX - 1);
+            anexarTexto(saida, " | ");
+            anexarInteiro(saida, mapa->tropas[i], 6);
+            anexarTexto(saida, "\n");
+        }
+        encontrados++;
+    }
+
+    long paginas = filtro->por_pagina > 0 ? (encontrados + filtro->por_pagina - 1) / filtro->por_pagina : 1;
+    if (paginas == 0) paginas = 1;
+    anexarFormatado(saida, "Página %ld de %ld (%ld território(s) no filtro, %d no mapa).\n",
+                    filtro->pagina > 0 ? filtro->pagina : 1, paginas, encontrados, mapa->total);
+}
+
+/**
+ * @brief Pergunta o filtro (cor, tropas mínimas e página) e exibe a tabela compacta.
+ */
+void consultarTerritorios(const Mapa* mapa) {
+    FiltroTerritorios filtro = {-1, 0, 1, EXIBICAO_POR_PAGINA};
+    char cor[COR_MAX];
+    char temp_str[MAX_BUFFER];
+
+    printf("\n--- Consulta de Territórios ---\n");
+    printf("Filtrar pela cor (Enter para todas): ");
+    if (fgets(cor, COR_MAX, stdin) == NULL) cor[0] = 0;
+    cor[strcspn(cor, "\n")] = 0;
+    if (cor[0] != 0) {
+        filtro.cor = buscarCor(mapa, cor);
+        if (filtro.cor < 0) {
+            printf("\n** ERRO: Nenhum território da cor '%s'. **\n", cor);
+            return;
+        }
+    }
+
+    printf("Tropas mínimas (Enter para qualquer): ");
+    if (fgets(temp_str, MAX_BUFFER, stdin) != NULL && sscanf(temp_str, "%d", &filtro.tropas_minimas) != 1) {
+        filtro.tropas_minimas = 0;
+    }
+
+    printf("Página (Enter para a primeira): ");
+    if (fgets(temp_str, MAX_BUFFER, stdin) == NULL || sscanf(temp_str, "%ld", &filtro.pagina) != 1 || filtro.pagina < 1) {
+        filtro.pagina = 1;
+    }
+
+    SaidaBuffer saida;
+    iniciarSaida(&saida, stdout);
+    exibirTabelaTerritorios(mapa, &filtro, &saida);
+    descarregarSaida(&saida);
+}
+
+// --- Fronteiras (grafo CSR) ---
+
+/**
+ * @brief Registra uma fronteira (nos dois sentidos) entre os territórios a e b.
+ * O grafo CSR é reconstruído sob demanda por atualizarGrafo().
+ * @return 0 em caso de sucesso, -1 se os ids forem inválidos ou faltar memória.
+ */
+int adicionarFronteira(Mapa* mapa, int a, int b) {
+    if (a < 0 || b < 0 || a >= mapa->total || b >= mapa->total || a == b) return -1;
+
+    if (mapa->total_fronteiras == mapa->capacidade_fronteiras) {
+        if (desvincularSnapshot(mapa) != 0) return -1;
+        long nova = (mapa->capacidade_fronteiras > 0) ? mapa->capacidade_fronteiras * 2 : CAPACIDADE_INICIAL;
+        int (*fronteiras)[2] = (int (*)[2])arenaAlocar(mapa->arena, (size_t)nova * sizeof(int[2]));
+        if (fronteiras == NULL) return -1;
+        if (mapa->total_fronteiras > 0) {
+            memcpy(fronteiras, mapa->fronteiras, (size_t)mapa->total_fronteiras * sizeof(int[2]));
+        }
+        mapa->fronteiras = fronteiras;
+        mapa->capacidade_fronteiras = nova;
+    }
+
+    mapa->fronteiras[mapa->total_fronteiras][0] = a;
+    mapa->fronteiras[mapa->total_fronteiras][1] = b;
+    mapa->total_fronteiras++;
+    mapa->grafo_valido = 0;
+    return 0;
+}
+
+static int compararInteiros(const void* a, const void* b) {
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief (Re)constrói o grafo CSR a partir da lista de fronteiras, se necessário.
+ * Contagem de graus + preenchimento em O(V + E); cada linha é ordenada e as
+ * fronteiras repetidas são descartadas. Os vetores do grafo anterior são
+ * reaproveitados e só crescem (dobrando) quando não cabem, como em
+ * garantirCapacidade(): cadastros intercalados com ataques não acumulam cópias.
+ * @return 0 em caso de sucesso, -1 se faltar memória.
+ */
+int atualizarGrafo(Mapa* mapa) {
+    if (mapa->grafo_valido) return 0;
+    contar(CONTADOR_VARREDURAS_MAPA, 1);
+    contar(CONTADOR_TERRITORIOS_VARRIDOS, mapa->total);
+
+    int n = mapa->total;
+    long entradas = mapa->total_fronteiras * 2;
+    if (n + 1 > mapa->capacidade_grafo_inicio) {
+        int nova = (mapa->capacidade_grafo_inicio > 0) ? mapa->capacidade_grafo_inicio : CAPACIDADE_INICIAL;
+        while (nova < n + 1) {
+            nova = (nova > INT32_MAX / 2) ? n + 1 : nova * 2;
+        }
+        int* inicio = (int*)arenaAlocar(mapa->arena, (size_t)nova * sizeof(int));
+        if (inicio == NULL) return -1;
+        mapa->grafo_inicio = inicio;
+        mapa->capacidade_grafo_inicio = nova;
+    }
+    if (entradas > mapa->capacidade_grafo_vizinhos || mapa->capacidade_grafo_vizinhos == 0) {
+        long nova = (mapa->capacidade_grafo_vizinhos > 0) ? mapa->capacidade_grafo_vizinhos : CAPACIDADE_INICIAL;
+        while (nova < entradas) nova *= 2;
+        int* vizinhos = (int*)arenaAlocar(mapa->arena, (size_t)nova * sizeof(int));
+        if (vizinhos == NULL) return -1;
+        mapa->grafo_vizinhos = vizinhos;
+        mapa->capacidade_grafo_vizinhos = nova;
+    }
+    int* inicio = mapa->grafo_inicio;
+    int* vizinhos = mapa->grafo_vizinhos;
+    int* posicao = (int*)alocar(((size_t)n + 1) * sizeof(int));
+    if (posicao == NULL) return -1;
+    memset(inicio, 0, ((size_t)n + 1) * sizeof(int));
+
+    for (long f = 0; f < mapa->total_fronteiras; f++) {
+        inicio[mapa->fronteiras[f][0] + 1]++;
+        inicio[mapa->fronteiras[f][1] + 1]++;
+    }
+    for (int i = 0; i < n; i++) {
+        inicio[i + 1] += inicio[i];
+    }
+    memcpy(posicao, inicio, ((size_t)n + 1) * sizeof(int));
+    for (long f = 0; f < mapa->total_fronteiras; f++) {
+        int a = mapa->fronteiras[f][0];
+        int b = mapa->fronteiras[f][1];
+        vizinhos[posicao[a]++] = b;
+        vizinhos[posicao[b]++] = a;
+    }
+
+    // Ordena cada linha e compacta removendo repetidos (in place, da esquerda para a direita)
+    int escrita = 0;
+    for (int i = 0; i < n; i++) {
+        int de = inicio[i];
+        int ate = inicio[i + 1];
+        int grau = ate - de;
+        int* linha = vizinhos + de;
+        if (grau <= ORDENACAO_INSERCAO_MAX) {
+            for (int k = 1; k < grau; k++) {
+                int v = linha[k];
+                int j = k - 1;
+                while (j >= 0 && linha[j] > v) {
+                    linha[j + 1] = linha[j];
+                    j--;
+                }
+                linha[j + 1] = v;
+            }
+        } else {
+            qsort(linha, (size_t)grau, sizeof(int), compararInteiros);
+        }
+
+        inicio[i] = escrita;
+        for (int k = de; k < ate; k++) {
+            if (k == de || vizinhos[k] != vizinhos[k - 1]) {
+                vizinhos[escrita++] = vizinhos[k];
+            }
+        }
+    }
+    inicio[n] = escrita;
+    free(posicao);
+
+    mapa->grafo_territorios = n;
+    mapa->grafo_valido = 1;
+    return 0;
+}
+
+/**
+ * @brief Indica se a e b fazem fronteira (busca binária na linha de a).
+ * Requer atualizarGrafo(). Sem fronteiras cadastradas, todos são vizinhos.
+ */
+int saoVizinhos(const Mapa* mapa, int a, int b) {
+    if (mapa->total_fronteiras == 0) return 1;
+    if (a >= mapa->grafo_territorios || b >= mapa->grafo_territorios) return 0;
+
+    int de = mapa->grafo_inicio[a];
+    int ate = mapa->grafo_inicio[a + 1];
+    while (de < ate) {
+        int meio = de + (ate - de) / 2;
+        int v = mapa->grafo_vizinhos[meio];
+        if (v == b) return 1;
+        if (v < b) de = meio + 1; else ate = meio;
+    }
+    return 0;
+}
+
+/**
+ * @brief Rotula as regiões do mapa: grupos de territórios da mesma cor ligados
+ * por fronteiras. Uma busca em largura sobre todo o grafo, O(V + E).
+ * @param rotulo Recebe o número da região de cada território (total posições).
+ * @param tamanho Recebe o tamanho de cada região (total posições).
+ * @return Quantidade de regiões, ou -1 se faltar memória.
+ */
+static int rotularRegioes(const Mapa* mapa, int* rotulo, int* tamanho) {
+    int n = mapa->total;
+    int* fila = (int*)alocar((size_t)(n > 0 ? n : 1) * sizeof(int));
+    if (fila == NULL) return -1;
+
+    for (int i = 0; i < n; i++) rotulo[i] = -1;
+    contar(CONTADOR_VARREDURAS_MAPA, 1);
+    contar(CONTADOR_TERRITORIOS_VARRIDOS, n);
+
+    int regioes = 0;
+    for (int origem = 0; origem < n; origem++) {
+        if (rotulo[origem] >= 0) continue;
+
+        int cabeca = 0, cauda = 0;
+        fila[cauda++] = origem;
+        rotulo[origem] = regioes;
+        while (cabeca < cauda) {
+            int t = fila[cabeca++];
+            if (t >= mapa->grafo_territorios) continue;
+            for (int k = mapa->grafo_inicio[t]; k < mapa->grafo_inicio[t + 1]; k++) {
+                int v = mapa->grafo_vizinhos[k];
+                if (rotulo[v] < 0 && mapa->dono[v] == mapa->dono[origem]) {
+                    rotulo[v] = regioes;
+                    fila[cauda++] = v;
+                }
+            }
+        }
+        tamanho[regioes++] = cauda;
+    }
+    free(fila);
+    return regioes;
+}
+
+/**
+ * @brief Tamanho da maior região contínua da cor (maior sequência de territórios
+ * ligados por fronteiras), limitada a 'limite': a busca para assim que encontra
+ * uma região desse tamanho. Requer atualizarGrafo(). Sem fronteiras, conta todos.
+ * Usa o rascunho do mapa (nada é alocado), então um mesmo mapa não pode ser
+ * consultado por duas threads ao mesmo tempo; as cópias de clonarMapa() têm o seu.
+ * @return Tamanho encontrado (no máximo 'limite').
+ */
+int maiorRegiao(const Mapa* mapa, int cor, int limite) {
+    if (mapa->total_fronteiras == 0) {
+        return mapa->territorios_por_cor[cor] < limite ? mapa->territorios_por_cor[cor] : limite;
+    }
+
+    // Nova geração = nenhum território visitado. Na volta do contador (a cada 2^32
+    // buscas), os carimbos são zerados de verdade.
+    RascunhoRegioes* rascunho = mapa->rascunho;
+    if (++rascunho->geracao == 0) {
+        memset(rascunho->visita, 0, (size_t)(mapa->capacidade > 0 ? mapa->capacidade : 1) * sizeof(uint32_t));
+        rascunho->geracao = 1;
+    }
+    uint32_t geracao = rascunho->geracao;
+    uint32_t* visita = rascunho->visita;
+    int* fila = rascunho->fila;
+
+    // Só os territórios da cor podem começar uma região.
+    const int* da_cor = territoriosDaCor(mapa, cor);
+    int maior = 0;
+    int k_origem = 0;
+    for (; k_origem < mapa->territorios_por_cor[cor] && maior < limite; k_origem++) {
+        int origem = da_cor[k_origem];
+        if (visita[origem] == geracao) continue;
+
+        int cabeca = 0, cauda = 0;
+        fila[cauda++] = origem;
+        visita[origem] = geracao;
+        while (cabeca < cauda && cauda < limite) {
+            int t = fila[cabeca++];
+            if (t >= mapa->grafo_territorios) continue;
+            for (int k = mapa->grafo_inicio[t]; k < mapa->grafo_inicio[t + 1] && cauda < limite; k++) {
+                int v = mapa->grafo_vizinhos[k];
+                if (visita[v] != geracao && mapa->dono[v] == cor) {
+                    visita[v] = geracao;
+                    fila[cauda++] = v;
+                }
+            }
+        }
+        if (cauda > maior) maior = cauda;
+    }
+    contar(CONTADOR_VARREDURAS_MAPA, 1);
+    contar(CONTADOR_TERRITORIOS_VARRIDOS, k_origem);
+    return maior;
+}
+
+/**
+ * @brief Resolve uma referência a território: um número é o id; qualquer outra
+ * coisa é procurada pelo nome exato (índice de nomes).
+ * @return Id do território, ou -1 se não existir.
+ */
+static int resolverReferenciaTerritorio(Mapa* mapa, const char* texto) {
+    char* fim;
+    long id = strtol(texto, &fim, 10);
+    while (*fim == ' ' || *fim == '\t') fim++;
+    if (fim != texto && *fim == 0) {
+        return (id >= 0 && id < mapa->total) ? (int)id : -1;
+    }
+    return buscarTerritorio(mapa, texto);
+}
+
+/**
+ * @brief Lê um território informado pelo jogador (id ou nome). Uma linha maior
+ * que qualquer nome é descartada por inteiro, para não virar a próxima resposta.
+ * @return Id do território, ou -1 se não existir.
+ */
+static int lerReferenciaTerritorio(Mapa* mapa) {
+    char temp_str[NOME_MAX + 2]; // nome + '\r' opcional + '\n'
+    if (fgets(temp_str, sizeof(temp_str), stdin) == NULL) return -1;
+    if (strchr(temp_str, '\n') == NULL && strlen(temp_str) == sizeof(temp_str) - 1) {
+        limparBufferEntrada();
+        return -1;
+    }
+    temp_str[strcspn(temp_str, "\r\n")] = 0;
+    return resolverReferenciaTerritorio(mapa, temp_str);
+}
+
+/**
+ * @brief Pede dois territórios ao jogador (id ou nome) e cadastra a fronteira entre eles.
+ */
+void cadastrarFronteira(Mapa* mapa) {
+    printf("\n--- Cadastro de Fronteira ---\n");
+    printf("Digite o ID ou o nome do primeiro território: ");
+    int a = lerReferenciaTerritorio(mapa);
+    printf("Digite o ID ou o nome do segundo território: ");
+    int b = lerReferenciaTerritorio(mapa);
+
+    if (adicionarFronteira(mapa, a, b) == 0) {
+        registrarFronteira(a, b);
+        printf("\n** Fronteira '%s' <-> '%s' registrada! **\n", mapa->nomes[a], mapa->nomes[b]);
+    } else {
+        printf("\n** ERRO: Territórios inválidos (devem estar cadastrados e ser diferentes). **\n");
+    }
+}
+
+/**
+ * @brief Mostra, para cada cor, quantas regiões contínuas ela tem e a maior delas.
+ */
+void exibirRegioes(Mapa* mapa) {
+    printf("\n--- Regiões por Cor ---\n");
+    if (mapa->total == 0) {
+        printf("Nenhum território/tropa foi cadastrado.\n");
+        return;
+    }
+
+    int* rotulo = (int*)alocar((size_t)mapa->total * sizeof(int));
+    int* tamanho = (int*)alocar((size_t)mapa->total * sizeof(int));
+    int regioes = (rotulo != NULL && tamanho != NULL && atualizarGrafo(mapa) == 0)
+                  ? rotularRegioes(mapa, rotulo, tamanho) : -1;
+    if (regioes < 0) {
+        printf("Memória insuficiente para analisar o mapa.\n");
+        free(rotulo);
+        free(tamanho);
+        return;
+    }
+
+    // Os rótulos são dados na ordem do primeiro território de cada região, então
+    // a primeira aparição do rótulo r (varrendo por id) é sempre a próxima esperada.
+    int quantidade[MAX_CORES] = {0};
+    int maior[MAX_CORES] = {0};
+    int proxima = 0;
+    for (int i = 0; i < mapa->total && proxima < regioes; i++) {
+        if (rotulo[i] == proxima) {
+            int cor = mapa->dono[i];
+            quantidade[cor]++;
+            if (tamanho[proxima] > maior[cor]) maior[cor] = tamanho[proxima];
+            proxima++;
+        }
+    }
+    free(rotulo);
+    free(tamanho);
+
+    printf("Fronteiras: %ld%s\n", mapa->total_fronteiras,
+           mapa->total_fronteiras == 0 ? " (sem geografia: todos os territórios são vizinhos)" : "");
+    for (int c = 0; c < mapa->cores.total; c++) {
+        if (mapa->territorios_por_cor[c] == 0) continue;
+        printf("%-9s territórios: %d, regiões: %d, maior região: %d\n", nomeDaCor(mapa, c),
+               mapa->territorios_por_cor[c], quantidade[c], maior[c]);
+    }
+}
+
+/**
+ * @brief Com várias cores em jogo (cor >= 0), ninguém recebe a missão de eliminar
+ * a própria cor ou uma cor que não está no mapa (seria cumprida de graça).
+ */
+static int eliminacaoInvalida(const DefinicaoMissao* definicao, const Mapa* mapa, int cor) {
+    if (cor < 0 || definicao->tipo != MISSAO_ELIMINAR_COR) return 0;
+    int alvo = buscarCor(mapa, definicao->parametro);
+    return alvo == cor || alvo < 0 || mapa->territorios_por_cor[alvo] == 0;
+}
+
+// Missões pré-definidas do jogo pelo menu (tipo + parâmetros; o texto é só para exibição)
+static const DefinicaoMissao MISSOES_MENU[] = {
+    {MISSAO_POSSUIR_TERRITORIOS, "Conquistar 3 territórios seguidos.", 3, NULL},
+    {MISSAO_ELIMINAR_COR, "Eliminar todas as tropas da cor Vermelho do mapa.", 0, "Vermelho"},
+    {MISSAO_TOTAL_TROPAS, "Ter mais de 10 tropas no total no final do turno.", 10, NULL},
+    {MISSAO_POSSUIR_TERRITORIO, "Possuir o território chamado 'Brasil'.", 0, "Brasil"},
+    {MISSAO_MAIORIA_TERRITORIOS, "Ter mais territórios do que qualquer outra cor.", 0, NULL}
+};
+
+#define TOTAL_MISSOES_MENU ((int)(sizeof(MISSOES_MENU) / sizeof(MISSOES_MENU[0])))
+
+/**
+ * @brief Compila a missão 'indice' do catálogo para o mapa (Passagem por referência).
+ * Nomes de cor e de território são resolvidos aqui, uma única vez.
+ * @param cor Cor do dono da missão, ou -1 no jogo de um jogador (menu).
+ */
+void compilarMissao(Missao* destino, const DefinicaoMissao missoes[], int indice, Mapa* mapa, int cor) {
+    const DefinicaoMissao* definicao = &missoes[indice];
+
+    destino->indice = indice;
+    destino->cor = cor;
+    destino->tipo = definicao->tipo;
+    destino->descricao = definicao->descricao;
+    destino->quantidade = definicao->quantidade;
+    destino->cor_alvo = -1;
+    destino->territorio_alvo[0] = 0;
+    destino->id_territorio_alvo = -1;
+
+    if (definicao->tipo == MISSAO_ELIMINAR_COR) {
+        // No menu a cor alvo pode ainda não ter sido cadastrada; com várias cores
+        // em jogo o mapa já está completo e não ganha cores novas.
+        destino->cor_alvo = (cor < 0) ? internarCor(mapa, definicao->parametro) : buscarCor(mapa, definicao->parametro);
+    } else if (definicao->tipo == MISSAO_POSSUIR_TERRITORIO) {
+        snprintf(destino->territorio_alvo, NOME_MAX, "%s", definicao->parametro);
+        destino->id_territorio_alvo = buscarTerritorio(mapa, destino->territorio_alvo);
+    }
+}
+
+/**
+ * @brief Sorteia uma missão e a compila para o mapa com compilarMissao().
+ * O sorteio é uniforme entre as missões válidas para a cor (eliminacaoInvalida()).
+ * @param destino Ponteiro para onde a missão será gravada.
+ * @param missoes Catálogo de missões disponíveis.
+ * @param totalMissoes Número total de missões.
+ * @param mapa Mapa da partida (no menu, a cor alvo é internada nele).
+ * @param cor Cor do dono da missão, ou -1 no jogo de um jogador (menu).
+ * @param gerador Gerador aleatório da partida.
+ */
+void atribuirMissao(Missao* destino, const DefinicaoMissao missoes[], int totalMissoes, Mapa* mapa, int cor,
+                    GeradorAleatorio* gerador) {
+    int validas = 0;
+    for (int m = 0; m < totalMissoes; m++) {
+        if (!eliminacaoInvalida(&missoes[m], mapa, cor)) validas++;
+    }
+    if (validas == 0) {
+        // Catálogo só com eliminações impossíveis: a missão sorteada fica sem alvo
+        // (cor_alvo -1) e nunca é cumprida; a partida termina por dominação.
+        compilarMissao(destino, missoes, (int)sortearLimitado(gerador, (uint32_t)totalMissoes), mapa, cor);
+        return;
+    }
+
+    // Sorteia a k-ésima válida, sem repetir sorteios.
+    int k = (int)sortearLimitado(gerador, (uint32_t)validas);
+    int indice = 0;
+    for (;; indice++) {
+        if (!eliminacaoInvalida(&missoes[indice], mapa, cor) && k-- == 0) break;
+    }
+    compilarMissao(destino, missoes, indice, mapa, cor);
+}
+
+/**
+ * @brief Chamada a cada cadastro: guarda o id se for o território que a missão pede.
+ */
+void vincularTerritorioMissao(Missao* missao, const Mapa* mapa, int id) {
+    if (missao->tipo == MISSAO_POSSUIR_TERRITORIO && missao->id_territorio_alvo < 0 &&
+        strcmp(mapa->nomes[id], missao->territorio_alvo) == 0) {
+        missao->id_territorio_alvo = id;
+    }
+}
+
+/**
+ * @brief Exibe a missão do jogador (Passagem por valor/constante).
+ * @param missao Missão sorteada.
+ */
+void exibirMissao(const Missao* missao) {
+    printf("\n=================================================\n");
+    printf("SUA MISSÃO SECRETA: %s\n", missao->descricao);
+    printf("=================================================\n");
+}
+
+/**
+ * @brief Cor do jogador no jogo de um jogador só (menu): a do primeiro território
+ * cadastrado. Partidas com turnos dão a cor de cada jogador em Missao.cor.
+ * @return Id da cor ou -1 se o mapa estiver vazio.
+ */
+int corDoJogador(const Mapa* mapa) {
+    return (mapa->total > 0) ? mapa->dono[0] : -1;
+}
+
+static int avaliarMissao(const Missao* missao, const Mapa* mapa) {
+    int cor_jogador = (missao->cor >= 0) ? missao->cor : corDoJogador(mapa);
+    if (cor_jogador < 0) return 0; // Nenhum território cadastrado
+
+    switch (missao->tipo) {
+        case MISSAO_POSSUIR_TERRITORIOS:
+            // "Conquistar 3 territórios seguidos": uma região contínua (ligada por
+            // fronteiras) com 'quantidade' territórios. O agregado descarta rápido.
+            if (mapa->territorios_por_cor[cor_jogador] < missao->quantidade) return 0;
+            return (maiorRegiao(mapa, cor_jogador, missao->quantidade) >= missao->quantidade);
+
+        case MISSAO_ELIMINAR_COR:
+            return (missao->cor_alvo >= 0 && mapa->territorios_por_cor[missao->cor_alvo] == 0);
+
+        case MISSAO_TOTAL_TROPAS:
+            return (mapa->tropas_por_cor[cor_jogador] > missao->quantidade);
+
+        case MISSAO_POSSUIR_TERRITORIO:
+            return (missao->id_territorio_alvo >= 0 && mapa->dono[missao->id_territorio_alvo] == cor_jogador);
+
+        case MISSAO_MAIORIA_TERRITORIOS:
+            for (int c = 0; c < mapa->cores.total; c++) {
+                if (c != cor_jogador && mapa->territorios_por_cor[c] >= mapa->territorios_por_cor[cor_jogador]) {
+                    return 0;
+                }
+            }
+            return 1;
+
+        case TOTAL_TIPOS_MISSAO:
+            break;
+    }
+
+    // Se a missão não tiver uma regra definida, nunca cumpre (para ser seguro)
+    return 0; 
+}
+
+/**
+ * @brief Verifica se a missão do jogador foi cumprida (Passagem por referência/constante).
+ * Cada tipo de missão é uma consulta aos agregados do mapa, sem varrer territórios
+ * (exceto a de territórios seguidos, que percorre o grafo; requer atualizarGrafo()).
+ * @param missao Missão compilada por atribuirMissao().
+ * @param mapa Ponteiro para o mapa.
+ * @return 1 se a missão foi cumprida, 0 caso contrário.
+ */
+int verificarMissao(const Missao* missao, const Mapa* mapa) {
+    uint64_t inicio = iniciarIntervalo();
+    int cumprida = avaliarMissao(missao, mapa);
+    encerrarIntervalo(INTERVALO_VERIFICAR_MISSAO, inicio);
+    return cumprida;
+}
+
+/**
+ * @brief Simula o ataque rolando um dado (1 a 6).
+ */
+int rolarDado(GeradorAleatorio* gerador) {
+    return (int)sortearLimitado(gerador, 6) + 1;
+}
+
+// Rodadas 3x2 em grupos de 4, para batalhaRelampago(): das 7776^4 combinações de
+// dados, quantas fazem o atacante perder no máximo k tropas (k = 0..7). São os
+// acumulados de (2890 + 2611x + 2275x²)^4, onde 2890, 2611 e 2275 contam as rodadas
+// 3x2 em que o atacante perde 0, 1 e 2 tropas.
+#define COMBINACOES_QUATRO_RODADAS 3656158440062976ULL // 7776^4 (cabe em 64 bits)
+static const uint64_t LIMIARES_QUATRO_RODADAS[8] = {
+    69757574410000ULL,   321850345046000ULL,  883135903290600ULL,  1684244387434960ULL,
+    2527950453364001ULL, 3158580834481101ULL, 3506397978359851ULL, 3629371345922351ULL
+};
+
+static inline int dadosDeAtaque(int tropas) {
+    return tropas - 1 < DADOS_ATAQUE_MAX ? tropas - 1 : DADOS_ATAQUE_MAX;
+}
+
+static inline int dadosDeDefesa(int tropas) {
+    return tropas < DADOS_DEFESA_MAX ? tropas : DADOS_DEFESA_MAX;
+}
+
+static inline void trocarDados(int* a, int* b) {
+    int t = *a;
+    *a = *b;
+    *b = t;
+}
+
+/**
+ * @brief Ordena os dados de cada lado (maior primeiro) e compara os pares: maior
+ * ataque contra maior defesa, segundo contra segundo. Empate é do defensor.
+ */
+static void compararDados(RodadaCombate* rodada) {
+    int* a = rodada->dados_ataque;
+    int* d = rodada->dados_defesa;
+    if (rodada->num_ataque > 1 && a[1] > a[0]) trocarDados(&a[0], &a[1]);
+    if (rodada->num_ataque > 2) {
+        if (a[2] > a[1]) trocarDados(&a[1], &a[2]);
+        if (a[1] > a[0]) trocarDados(&a[0], &a[1]);
+    }
+    if (rodada->num_defesa > 1 && d[1] > d[0]) trocarDados(&d[0], &d[1]);
+
+    int pares = rodada->num_ataque < rodada->num_defesa ? rodada->num_ataque : rodada->num_defesa;
+    rodada->perdas_atacante = 0;
+    for (int i = 0; i < pares; i++) {
+        rodada->perdas_atacante += (a[i] <= d[i]);
+    }
+    rodada->perdas_defensor = pares - rodada->perdas_atacante;
+}
+
+/**
+ * @brief Rola uma rodada: o atacante usa até 3 dados (deixando 1 tropa para trás)
+ * e o defensor até 2. Requer tropas_atacante >= 2 e tropas_defensor >= 1.
+ */
+void rolarRodada(RodadaCombate* rodada, int tropas_atacante, int tropas_defensor, GeradorAleatorio* gerador) {
+    rodada->num_ataque = dadosDeAtaque(tropas_atacante);
+    rodada->num_defesa = dadosDeDefesa(tropas_defensor);
+    for (int i = 0; i < rodada->num_ataque; i++) rodada->dados_ataque[i] = rolarDado(gerador);
+    for (int i = 0; i < rodada->num_defesa; i++) rodada->dados_defesa[i] = rolarDado(gerador);
+    compararDados(rodada);
+}
+
+/**
+ * @brief rolarRodada() com os dados vindos de um lote (laços de simulação).
+ */
+void rolarRodadaLote(RodadaCombate* rodada, int tropas_atacante, int tropas_defensor, LoteDados* lote) {
+    rodada->num_ataque = dadosDeAtaque(tropas_atacante);
+    rodada->num_defesa = dadosDeDefesa(tropas_defensor);
+    for (int i = 0; i < rodada->num_ataque; i++) rodada->dados_ataque[i] = proximoDado(lote);
+    for (int i = 0; i < rodada->num_defesa; i++) rodada->dados_defesa[i] = proximoDado(lote);
+    compararDados(rodada);
+}
+
+/**
+ * @brief Aplica uma rodada às tropas (sem imprimir nada). Quando o defensor fica
+ * sem tropas, o território é conquistado: avança metade das tropas do atacante,
+ * e pelo menos tantas quantos foram os dados da última rolagem.
+ * @return 1 se o território defensor foi conquistado, 0 caso contrário.
+ */
+int resolverCombate(int *tropas_atacante, int *tropas_defensor, const RodadaCombate* rodada) {
+    *tropas_atacante -= rodada->perdas_atacante;
+    *tropas_defensor -= rodada->perdas_defensor;
+    if (*tropas_defensor > 0) {
+        return 0;
+    }
+
+    // Na rodada da conquista o atacante não perde nada, então sobram >= num_ataque + 1 tropas.
+    int tropas_movidas = *tropas_atacante / 2;
+    if (tropas_movidas < rodada->num_ataque) tropas_movidas = rodada->num_ataque;
+    *tropas_atacante -= tropas_movidas;
+    *tropas_defensor = tropas_movidas;
+    return 1;
+}
+
+/**
+ * @brief Batalha "relâmpago": rodadas até conquistar ou o atacante ficar com 1 tropa.
+ * Enquanto os dois exércitos aguentam 4 rodadas 3x2 seguidas (atacante >= 10,
+ * defensor >= 8), um único sorteio de 64 bits resolve as 4 de uma vez, comparando
+ * com LIMIARES_QUATRO_RODADAS sem desvios; a distribuição é exatamente a de rolar
+ * os 20 dados. O final da batalha é jogado rodada a rodada.
+ * @return 1 se conquistou (tropas já movidas), 0 caso contrário.
+ */
+int batalhaRelampago(int *tropas_atacante, int *tropas_defensor, LoteDados* lote) {
+    int a = *tropas_atacante;
+    int d = *tropas_defensor;
+    while (a >= 10 && d >= 8) {
+        uint64_t sorteio = sortearLimitado64(lote->gerador, COMBINACOES_QUATRO_RODADAS);
+        int perdas_atacante = 0;
+        for (int k = 0; k < 8; k++) {
+            perdas_atacante += (sorteio >= LIMIARES_QUATRO_RODADAS[k]);
+        }
+        a -= perdas_atacante;
+        d -= 8 - perdas_atacante;
+    }
+
+    int conquistou = 0;
+    if (d == 0) {
+        // O grupo terminou na conquista: a última rodada foi 3x2, sem perdas do atacante.
+        RodadaCombate ultima = {DADOS_ATAQUE_MAX, DADOS_DEFESA_MAX, {0}, {0}, 0, 0};
+        conquistou = resolverCombate(&a, &d, &ultima);
+    }
+    while (!conquistou && a >= 2 && d >= 1) {
+        RodadaCombate rodada;
+        rolarRodadaLote(&rodada, a, d, lote);
+        conquistou = resolverCombate(&a, &d, &rodada);
+    }
+    *tropas_atacante = a;
+    *tropas_defensor = d;
+    return conquistou;
+}
+
+/**
+ * @brief Guarda o estado atual do território no registro de desfazer.
+ */
+static void registrarAlteracao(Mapa* mapa, int id) {
+    if (mapa->total_desfazer == mapa->capacidade_desfazer) {
+        long nova = (mapa->capacidade_desfazer > 0) ? mapa->capacidade_desfazer * 2 : CAPACIDADE_INICIAL;
+        AlteracaoMapa* entradas = (AlteracaoMapa*)arenaAlocar(mapa->arena, (size_t)nova * sizeof(AlteracaoMapa));
+        if (entradas == NULL) {
+            mapa->desfazer_incompleto = 1;
+            return;
+        }
+        if (mapa->total_desfazer > 0) {
+            memcpy(entradas, mapa->desfazer, (size_t)mapa->total_desfazer * sizeof(AlteracaoMapa));
+        }
+        mapa->desfazer = entradas;
+        mapa->capacidade_desfazer = nova;
+    }
+
+    AlteracaoMapa* entrada = &mapa->desfazer[mapa->total_desfazer++];
+    entrada->id = id;
+    entrada->tropas = mapa->tropas[id];
+    entrada->posicao = mapa->posicao_na_ordem[id];
+    entrada->dono = mapa->dono[id];
+}
+
+/**
+ * @brief Liga o registro de desfazer, começando vazio.
+ */
+void ativarDesfazer(Mapa* mapa) {
+    mapa->registrando = 1;
+    mapa->total_desfazer = 0;
+    mapa->desfazer_incompleto = 0;
+}
+
+/**
+ * @brief Ponto do registro para onde desfazerAte() pode voltar depois.
+ */
+long marcarDesfazer(const Mapa* mapa) {
+    return mapa->total_desfazer;
+}
+
+/**
+ * @brief Desfaz, da mais nova para a mais antiga, as alterações feitas depois
+ * de 'marca', restaurando dono, tropas e agregados. A troca de dono é revertida
+ * passo a passo em ordem_por_cor, que volta exatamente à ordem anterior.
+ * @return 0 em caso de sucesso, -1 se o registro ficou incompleto (o mapa não é restaurado).
+ */
+int desfazerAte(Mapa* mapa, long marca) {
+    if (mapa->desfazer_incompleto) return -1;
+
+    while (mapa->total_desfazer > marca) {
+        const AlteracaoMapa* entrada = &mapa->desfazer[--mapa->total_desfazer];
+        int id = entrada->id;
+        int cor_atual = mapa->dono[id];
+        if (cor_atual != entrada->dono) {
+            moverNaOrdem(mapa, id, cor_atual, entrada->dono);
+            trocarNaOrdem(mapa, mapa->posicao_na_ordem[id], entrada->posicao);
+        }
+        mapa->territorios_por_cor[cor_atual]--;
+        mapa->tropas_por_cor[cor_atual] -= mapa->tropas[id];
+        mapa->tropas_total += entrada->tropas - mapa->tropas[id];
+
+        mapa->dono[id] = entrada->dono;
+        mapa->tropas[id] = entrada->tropas;
+        mapa->territorios_por_cor[entrada->dono]++;
+        mapa->tropas_por_cor[entrada->dono] += entrada->tropas;
+    }
+    return 0;
+}
+
+/**
+ * @brief Desliga o registro de desfazer (as alterações passam a ser definitivas).
+ */
+void desativarDesfazer(Mapa* mapa) {
+    mapa->registrando = 0;
+    mapa->total_desfazer = 0;
+    mapa->desfazer_incompleto = 0;
+}
+
+/**
+ * @brief Soma 'delta' às tropas de um território, mantendo os agregados.
+ */
+void alterarTropas(Mapa* mapa, int id, int delta) {
+    if (mapa->registrando) registrarAlteracao(mapa, id);
+    mapa->tropas[id] += delta;
+    mapa->tropas_por_cor[mapa->dono[id]] += delta;
+    mapa->tropas_total += delta;
+}
+
+/**
+ * @brief Passa um território para outra cor, movendo suas tropas entre os
+ * agregados e o território entre os segmentos de ordem_por_cor.
+ */
+void trocarDono(Mapa* mapa, int id, int nova_cor) {
+    if (mapa->registrando) registrarAlteracao(mapa, id);
+    int antiga = mapa->dono[id];
+    moverNaOrdem(mapa, id, antiga, nova_cor);
+    mapa->territorios_por_cor[antiga]--;
+    mapa->tropas_por_cor[antiga] -= mapa->tropas[id];
+    mapa->dono[id] = (uint8_t)nova_cor;
+    mapa->territorios_por_cor[nova_cor]++;
+    mapa->tropas_por_cor[nova_cor] += mapa->tropas[id];
+}
+
+/**
+ * @brief Grava no mapa as tropas resultantes de um combate (e a troca de dono).
+ */
+static void gravarCombate(Mapa* mapa, int id_atacante, int id_defensor, int tropas_atacante, int tropas_defensor,
+                          int conquistou) {
+    alterarTropas(mapa, id_atacante, tropas_atacante - mapa->tropas[id_atacante]);
+    alterarTropas(mapa, id_defensor, tropas_defensor - mapa->tropas[id_defensor]);
+    if (conquistou) {
+        trocarDono(mapa, id_defensor, mapa->dono[id_atacante]);
+    }
+}
+
+/**
+ * @brief Aplica uma rodada de ataque ao mapa (sem imprimir), atualizando os agregados.
+ * @return 1 se o defensor foi conquistado, 0 caso contrário.
+ */
+int aplicarCombate(Mapa* mapa, int id_atacante, int id_defensor, const RodadaCombate* rodada) {
+    int tropas_atacante = mapa->tropas[id_atacante];
+    int tropas_defensor = mapa->tropas[id_defensor];
+    int conquistou = resolverCombate(&tropas_atacante, &tropas_defensor, rodada);
+    gravarCombate(mapa, id_atacante, id_defensor, tropas_atacante, tropas_defensor, conquistou);
+    return conquistou;
+}
+
+/**
+ * @brief Aplica ao mapa uma batalha inteira (batalhaRelampago()), sem imprimir.
+ * Requer pelo menos 2 tropas no atacante.
+ * @return 1 se o defensor foi conquistado, 0 se o atacante ficou com 1 tropa.
+ */
+int aplicarBatalha(Mapa* mapa, int id_atacante, int id_defensor, LoteDados* lote) {
+    int tropas_atacante = mapa->tropas[id_atacante];
+    int tropas_defensor = mapa->tropas[id_defensor];
+    int conquistou = batalhaRelampago(&tropas_atacante, &tropas_defensor, lote);
+    gravarCombate(mapa, id_atacante, id_defensor, tropas_atacante, tropas_defensor, conquistou);
+    return conquistou;
+}
+
+static void anexarDados(SaidaBuffer* relatorio, const int dados[], int quantidade) {
+    for (int i = 0; i < quantidade; i++) {
+        anexarTexto(relatorio, " ");
+        anexarInteiro(relatorio, dados[i], 0);
+    }
+    anexarTexto(relatorio, "\n");
+}
+
+static void jogarRodada(Mapa* mapa, int id_atacante, int id_defensor, GeradorAleatorio* gerador, SaidaBuffer* relatorio) {
+    const char* nome_atacante = mapa->nomes[id_atacante];
+    const char* nome_defensor = mapa->nomes[id_defensor];
+
+    if (mapa->tropas[id_atacante] < 2) {
+        if (relatorio != NULL) {
+            anexarFormatado(relatorio, "Ataque cancelado: %s não tem tropas suficientes para atacar.\n", nome_atacante);
+        }
+        return;
+    }
+
+    RodadaCombate rodada;
+    rolarRodada(&rodada, mapa->tropas[id_atacante], mapa->tropas[id_defensor], gerador);
+    int conquistou = aplicarCombate(mapa, id_atacante, id_defensor, &rodada);
+    registrarRodada(id_atacante, id_defensor, &rodada);
+    contar(CONTADOR_ATAQUES, 1);
+    contar(CONTADOR_CONQUISTAS, conquistou);
+    if (relatorio == NULL) return;
+
+    anexarFormatado(relatorio, "\n--- Batalha: %s vs. %s ---\n", nome_atacante, nome_defensor);
+    anexarFormatado(relatorio, "Dados Ataque (%s):", nome_atacante);
+    anexarDados(relatorio, rodada.dados_ataque, rodada.num_ataque);
+    anexarFormatado(relatorio, "Dados Defesa (%s):", nome_defensor);
+    anexarDados(relatorio, rodada.dados_defesa, rodada.num_defesa);
+
+    if (conquistou) {
+        // Vitoria do Atacante: CONQUISTA (dono e tropas já atualizados por aplicarCombate)
+        anexarFormatado(relatorio, "\n*** VITÓRIA! '%s' CONQUISTOU '%s'! ***\n", nome_atacante, nome_defensor);
+        anexarFormatado(relatorio, "%d tropas movidas para o território conquistado.\n", mapa->tropas[id_defensor]);
+        return;
+    }
+
+    if (rodada.perdas_defensor == 0) {
+        anexarFormatado(relatorio, "\n*** DERROTA! '%s' defendeu o ataque. ***\n", nome_defensor);
+    } else if (rodada.perdas_atacante == 0) {
+        anexarFormatado(relatorio, "\n*** '%s' venceu a rodada, mas '%s' resiste. ***\n", nome_atacante, nome_defensor);
+    } else {
+        anexarTexto(relatorio, "\n*** EMPATE! Os dois lados perderam tropas. ***\n");
+    }
+    anexarFormatado(relatorio, "Perdas: atacante %d, defensor %d. Tropas restantes: %s %d, %s %d.\n",
+                    rodada.perdas_atacante, rodada.perdas_defensor, nome_atacante, mapa->tropas[id_atacante],
+                    nome_defensor, mapa->tropas[id_defensor]);
+}
+
+/**
+ * @brief Simula uma rodada de batalha entre dois territórios e atualiza seus estados.
+ * @param relatorio Buffer onde o relato da batalha é montado (o chamador
+ * descarrega), ou NULL para não relatar nada (modo silencioso).
+ */
+void atacar(Mapa* mapa, int id_atacante, int id_defensor, GeradorAleatorio* gerador, SaidaBuffer* relatorio) {
+    uint64_t inicio = iniciarIntervalo();
+    jogarRodada(mapa, id_atacante, id_defensor, gerador, relatorio);
+    encerrarIntervalo(INTERVALO_ATACAR, inicio);
+}
+
+static void jogarBatalhaRelampago(Mapa* mapa, int id_atacante, int id_defensor, GeradorAleatorio* gerador,
+                                  SaidaBuffer* relatorio) {
+    const char* nome_atacante = mapa->nomes[id_atacante];
+    const char* nome_defensor = mapa->nomes[id_defensor];
+    int tropas_atacante = mapa->tropas[id_atacante];
+    int tropas_defensor = mapa->tropas[id_defensor];
+
+    LoteDados lote;
+    iniciarLoteDados(&lote, gerador);
+    int conquistou = aplicarBatalha(mapa, id_atacante, id_defensor, &lote);
+    registrarRelampago(mapa, id_atacante, id_defensor);
+    contar(CONTADOR_ATAQUES_RELAMPAGO, 1);
+    contar(CONTADOR_CONQUISTAS, conquistou);
+    if (relatorio == NULL) return;
+
+    int perdas_defensor = tropas_defensor - (conquistou ? 0 : mapa->tropas[id_defensor]);
+    int perdas_atacante = tropas_atacante - mapa->tropas[id_atacante] - (conquistou ? mapa->tropas[id_defensor] : 0);
+    anexarFormatado(relatorio, "\n--- Ataque relâmpago: %s (%d) vs. %s (%d) ---\n", nome_atacante, tropas_atacante,
+                    nome_defensor, tropas_defensor);
+    anexarFormatado(relatorio, "Perdas: atacante %d, defensor %d.\n", perdas_atacante, perdas_defensor);
+    if (conquistou) {
+        anexarFormatado(relatorio, "\n*** VITÓRIA! '%s' CONQUISTOU '%s'! ***\n", nome_atacante, nome_defensor);
+        anexarFormatado(relatorio, "%d tropas movidas para o território conquistado.\n", mapa->tropas[id_defensor]);
+    } else {
+        anexarFormatado(relatorio, "\n*** DERROTA! '%s' ficou sem tropas para atacar; '%s' resistiu com %d. ***\n",
+                        nome_atacante, nome_defensor, mapa->tropas[id_defensor]);
+    }
+}
+
+/**
+ * @brief Ataque relâmpago: rodadas seguidas até conquistar o território ou o
+ * atacante ficar com 1 tropa; o relato traz só o resultado final.
+ */
+void atacarAteConquistar(Mapa* mapa, int id_atacante, int id_defensor, GeradorAleatorio* gerador, SaidaBuffer* relatorio) {
+    uint64_t inicio = iniciarIntervalo();
+    jogarBatalhaRelampago(mapa, id_atacante, id_defensor, gerador, relatorio);
+    encerrarIntervalo(INTERVALO_ATACAR_ATE_CONQUISTAR, inicio);
+}
+
+/**
+ * @brief Regras de um ataque, sem prompts (as mesmas que iniciarAtaque() confere
+ * com o jogador): usadas pelo replay e pelo modo servidor. Monta o grafo se preciso.
+ * @return NULL se o ataque é válido, ou o motivo da recusa.
+ */
+static const char* motivoAtaqueInvalido(Mapa* mapa, int id_atacante, int id_defensor) {
+    if (id_atacante < 0 || id_atacante >= mapa->total) return "atacante não cadastrado";
+    if (id_defensor < 0 || id_defensor >= mapa->total) return "defensor não cadastrado";
+    if (id_atacante == id_defensor) return "um território não pode atacar a si mesmo";
+    if (mapa->dono[id_atacante] == mapa->dono[id_defensor]) return "atacante e defensor são da mesma cor";
+    if (atualizarGrafo(mapa) != 0) return "memória insuficiente para o grafo de fronteiras";
+    if (!saoVizinhos(mapa, id_atacante, id_defensor)) return "os territórios não fazem fronteira";
+    if (mapa->tropas[id_atacante] < 2) return "o atacante precisa de no mínimo 2 tropas";
+    return NULL;
+}
+
+static void conduzirAtaque(Mapa* mapa, const Missao* missao_do_jogador, int *jogo_vencido, GeradorAleatorio* gerador,
+                           SaidaBuffer* relatorio) {
+    if (mapa->total < 2) {
+        printf("\nÉ necessário cadastrar no mínimo 2 territórios para atacar.\n");
+        return;
+    }
+    if (atualizarGrafo(mapa) != 0) {
+        printf("\nMemória insuficiente para montar o grafo de fronteiras.\n");
+        return;
+    }
+
+    exibirTerritorios(mapa);
+
+    char temp_str[MAX_BUFFER];
+
+    printf("\nDigite o ID ou o nome do território ATACANTE: ");
+    int id_atacante = lerReferenciaTerritorio(mapa);
+    if (id_atacante < 0) {
+        printf("Atacante inválido (ID ou nome não cadastrado).\n");
+        return;
+    }
+
+    printf("Digite o ID ou o nome do território DEFENSOR: ");
+    int id_defensor = lerReferenciaTerritorio(mapa);
+    if (id_defensor < 0) {
+        printf("Defensor inválido (ID ou nome não cadastrado).\n");
+        return;
+    }
+
+    if (id_atacante == id_defensor) {
+        printf("Um território não pode atacar a si mesmo!\n");
+        return;
+    }
+
+    // Validação: Não pode atacar o próprio time (mesma cor)
+    if (mapa->dono[id_atacante] == mapa->dono[id_defensor]) {
+        printf("ERRO: O território atacante e defensor são da mesma cor (%s). Não é possível atacar aliados.\n", nomeDaCor(mapa, mapa->dono[id_atacante]));
+        return;
+    }
+
+    // Validação: só é possível atacar um território vizinho
+    if (!saoVizinhos(mapa, id_atacante, id_defensor)) {
+        printf("ERRO: '%s' não faz fronteira com '%s'.\n", mapa->nomes[id_atacante], mapa->nomes[id_defensor]);
+        return;
+    }
+
+    if (mapa->tropas[id_atacante] < 2) {
+        printf("O território atacante precisa de no mínimo 2 tropas (1 para atacar + 1 de reserva)!\n");
+        return;
+    }
+
+    printf("Atacar até conquistar ou ficar sem tropas? (s/N): ");
+    int relampago = (fgets(temp_str, MAX_BUFFER, stdin) != NULL && (temp_str[0] == 's' || temp_str[0] == 'S'));
+
+    // Inicia o Ataque
+    if (relampago) {
+        atacarAteConquistar(mapa, id_atacante, id_defensor, gerador, relatorio);
+    } else {
+        atacar(mapa, id_atacante, id_defensor, gerador, relatorio);
+    }
+
+    // Exibição pós-ataque
+    if (relatorio != NULL) {
+        anexarTexto(relatorio, "\n--- Dados atualizados pós-ataque ---\n");
+        anexarFormatado(relatorio, "Atacante:\n Nome: %s, Cor: %s, Tropas: %d\n", mapa->nomes[id_atacante],
+                        nomeDaCor(mapa, mapa->dono[id_atacante]), mapa->tropas[id_atacante]);
+        anexarFormatado(relatorio, "Defensor:\n Nome: %s, Cor: %s, Tropas: %d\n", mapa->nomes[id_defensor],
+                        nomeDaCor(mapa, mapa->dono[id_defensor]), mapa->tropas[id_defensor]);
+        descarregarSaida(relatorio);
+    }
+
+    // VERIFICAÇÃO DE MISSÃO (NOVA FUNCIONALIDADE)
+    if (verificarMissao(missao_do_jogador, mapa)) {
+        *jogo_vencido = 1; // Altera a flag de vitória por referência
+    }
+}
+
+/**
+ * @brief Recebe o input do usuário e inicia a simulação de ataque.
+ * @param missao_do_jogador Ponteiro para a missão (necessário para checar vitória).
+ * @param jogo_vencido Ponteiro para flag de vitória (passagem por referência).
+ * @param gerador Gerador aleatório da partida.
+ * @param relatorio Buffer do relato da batalha e dos dados pós-ataque (enviados
+ * de uma vez), ou NULL no modo silencioso.
+ */
+void iniciarAtaque(Mapa* mapa, const Missao* missao_do_jogador, int *jogo_vencido, GeradorAleatorio* gerador,
+                   SaidaBuffer* relatorio) {
+    uint64_t inicio = iniciarIntervalo();
+    conduzirAtaque(mapa, missao_do_jogador, jogo_vencido, gerador, relatorio);
+    encerrarIntervalo(INTERVALO_INICIAR_ATAQUE, inicio);
+}
+
+// --- Snapshot Binário do Mapa ---
+
+static uint64_t alinharDeslocamento(uint64_t deslocamento) {
+    return (deslocamento + SNAPSHOT_ALINHAMENTO - 1) / SNAPSHOT_ALINHAMENTO * SNAPSHOT_ALINHAMENTO;
+}
+
+/**
+ * @brief Escreve todas as partes com writev(), repetindo só se o kernel aceitar
+ * menos bytes que o pedido (arquivos muito grandes).
+ * @return 0 em caso de sucesso, -1 em erro de escrita.
+ */
+static int escreverPartes(int fd, struct iovec* partes, int n) {
+    while (n > 0) {
+        ssize_t escrito = writev(fd, partes, n);
+        if (escrito < 0) return -1;
+        contar(CONTADOR_BYTES_ESCRITOS, escrito);
+        while (n > 0 && (size_t)escrito >= partes->iov_len) {
+            escrito -= (ssize_t)partes->iov_len;
+            partes++;
+            n--;
+        }
+        if (n > 0) {
+            partes->iov_base = (char*)partes->iov_base + escrito;
+            partes->iov_len -= (size_t)escrito;
+        }
+    }
+    return 0;
+}
+
+static int gravarSnapshot(const char* caminho, const Mapa* mapa, const Missao* missao, const GeradorAleatorio* gerador) {
+    static const char preenchimento[SNAPSHOT_ALINHAMENTO] = {0};
+    CabecalhoSnapshot* cabecalho = (CabecalhoSnapshot*)alocarZerado(1, sizeof(CabecalhoSnapshot));
+    if (cabecalho == NULL) return -1;
+
+    size_t bytes_tropas = (size_t)mapa->total * sizeof(int);
+    size_t bytes_fronteiras = (size_t)mapa->total_fronteiras * sizeof(int[2]);
+    size_t bytes_dono = (size_t)mapa->total * sizeof(uint8_t);
+    size_t bytes_nomes = (size_t)mapa->total * NOME_MAX;
+
+    memcpy(cabecalho->magica, SNAPSHOT_MAGICA, sizeof(SNAPSHOT_MAGICA));
+    cabecalho->versao = SNAPSHOT_VERSAO;
+    cabecalho->tamanho_cabecalho = sizeof(CabecalhoSnapshot);
+    cabecalho->total = mapa->total;
+    cabecalho->total_cores = mapa->cores.total;
+    cabecalho->total_fronteiras = mapa->total_fronteiras;
+    cabecalho->deslocamento_tropas = alinharDeslocamento(sizeof(CabecalhoSnapshot));
+    cabecalho->deslocamento_fronteiras = alinharDeslocamento(cabecalho->deslocamento_tropas + bytes_tropas);
+    cabecalho->deslocamento_dono = alinharDeslocamento(cabecalho->deslocamento_fronteiras + bytes_fronteiras);
+    cabecalho->deslocamento_nomes = alinharDeslocamento(cabecalho->deslocamento_dono + bytes_dono);
+    cabecalho->tamanho_arquivo = cabecalho->deslocamento_nomes + bytes_nomes;
+
+    memcpy(cabecalho->nomes_cores, mapa->cores.nomes, sizeof(cabecalho->nomes_cores));
+    for (int c = 0; c < MAX_CORES; c++) {
+        cabecalho->territorios_por_cor[c] = mapa->territorios_por_cor[c];
+        cabecalho->tropas_por_cor[c] = mapa->tropas_por_cor[c];
+    }
+    cabecalho->tropas_total = mapa->tropas_total;
+
+    cabecalho->missao_indice = missao->indice;
+    cabecalho->missao_tipo = missao->tipo;
+    cabecalho->missao_quantidade = missao->quantidade;
+    cabecalho->missao_cor_alvo = missao->cor_alvo;
+    cabecalho->missao_id_territorio_alvo = missao->id_territorio_alvo;
+    memcpy(cabecalho->missao_territorio_alvo, missao->territorio_alvo, NOME_MAX);
+    memcpy(cabecalho->estado_gerador, gerador->estado, sizeof(cabecalho->estado_gerador));
+
+    // Cabeçalho e vetores, cada um seguido do preenchimento até o próximo deslocamento
+    const void* secoes[5] = {cabecalho, mapa->tropas, mapa->fronteiras, mapa->dono, mapa->nomes};
+    size_t tamanhos[5] = {sizeof(CabecalhoSnapshot), bytes_tropas, bytes_fronteiras, bytes_dono, bytes_nomes};
+    uint64_t proximos[5] = {cabecalho->deslocamento_tropas, cabecalho->deslocamento_fronteiras,
+                            cabecalho->deslocamento_dono, cabecalho->deslocamento_nomes, cabecalho->tamanho_arquivo};
+    struct iovec partes[10];
+    int n = 0;
+    uint64_t posicao = 0;
+    for (int k = 0; k < 5; k++) {
+        if (tamanhos[k] > 0) {
+            partes[n].iov_base = (void*)secoes[k];
+            partes[n++].iov_len = tamanhos[k];
+        }
+        if (proximos[k] > posicao + tamanhos[k]) {
+            partes[n].iov_base = (void*)preenchimento;
+            partes[n++].iov_len = proximos[k] - (posicao + tamanhos[k]);
+        }
+        posicao = proximos[k];
+    }
+
+    char temporario[CAMINHO_MAX + 8];
+    snprintf(temporario, sizeof(temporario), "%s.tmp", caminho);
+    int fd = open(temporario, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        free(cabecalho);
+        return -1;
+    }
+
+    int ok = (escreverPartes(fd, partes, n) == 0);
+    free(cabecalho);
+
+    if (close(fd) != 0 || !ok || rename(temporario, caminho) != 0) {
+        unlink(temporario);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Grava mapa, fronteiras, missão e estado do gerador em um arquivo binário
+ * versionado. Tudo sai em uma única chamada writev(); o arquivo é escrito em
+ * "caminho.tmp" e renomeado no final, para nunca deixar um snapshot pela metade.
+ * @return 0 em caso de sucesso, -1 em caso de erro (errno preenchido).
+ */
+int salvarSnapshot(const char* caminho, const Mapa* mapa, const Missao* missao, const GeradorAleatorio* gerador) {
+    uint64_t inicio = iniciarIntervalo();
+    int resultado = gravarSnapshot(caminho, mapa, missao, gerador);
+    encerrarIntervalo(INTERVALO_SALVAR_SNAPSHOT, inicio);
+    return resultado;
+}
+
+/**
+ * @brief Confere se um vetor do snapshot cabe no arquivo e está alinhado para o
+ * tipo com que será lido. Escrito como subtração: deslocamento + bytes poderia
+ * dar a volta em 64 bits com um deslocamento forjado.
+ */
+static int regiaoSnapshotValida(uint64_t deslocamento, uint64_t bytes, size_t alinhamento, size_t tamanho) {
+    return deslocamento <= tamanho && bytes <= tamanho - deslocamento && deslocamento % alinhamento == 0;
+}
+
+static Mapa* abrirSnapshot(const char* caminho, Arena* arena, Missao* missao, GeradorAleatorio* gerador) {
+    int fd = open(caminho, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(CabecalhoSnapshot)) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t tamanho = (size_t)info.st_size;
+    void* base = mmap(NULL, tamanho, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return NULL;
+
+    const CabecalhoSnapshot* cabecalho = (const CabecalhoSnapshot*)base;
+    int valido = memcmp(cabecalho->magica, SNAPSHOT_MAGICA, sizeof(SNAPSHOT_MAGICA)) == 0 &&
+                 cabecalho->versao == SNAPSHOT_VERSAO &&
+                 cabecalho->tamanho_cabecalho == sizeof(CabecalhoSnapshot) &&
+                 cabecalho->tamanho_arquivo == tamanho &&
+                 cabecalho->total >= 0 && cabecalho->total_cores >= 0 && cabecalho->total_cores <= MAX_CORES &&
+                 regiaoSnapshotValida(cabecalho->deslocamento_tropas, (uint64_t)cabecalho->total * sizeof(int),
+                                      _Alignof(int), tamanho) &&
+                 regiaoSnapshotValida(cabecalho->deslocamento_dono, (uint64_t)cabecalho->total, 1, tamanho) &&
+                 regiaoSnapshotValida(cabecalho->deslocamento_nomes, (uint64_t)cabecalho->total * NOME_MAX, 1, tamanho) &&
+                 cabecalho->total_fronteiras >= 0 &&
+                 regiaoSnapshotValida(cabecalho->deslocamento_fronteiras,
+                                      (uint64_t)cabecalho->total_fronteiras * sizeof(int[2]), _Alignof(int), tamanho) &&
+                 cabecalho->missao_tipo >= 0 && cabecalho->missao_tipo < TOTAL_TIPOS_MISSAO &&
+                 cabecalho->missao_id_territorio_alvo < cabecalho->total &&
+                 cabecalho->missao_cor_alvo < cabecalho->total_cores;
+
+    Mapa* mapa = valido ? (Mapa*)arenaAlocar(arena, sizeof(Mapa)) : NULL;
+    if (mapa == NULL) {
+        munmap(base, tamanho);
+        return NULL;
+    }
+
+    unsigned char* bytes = (unsigned char*)base;
+    mapa->arena = arena;
+    mapa->total = cabecalho->total;
+    mapa->capacidade = cabecalho->total;
+    mapa->tropas = (int*)(bytes + cabecalho->deslocamento_tropas);
+    mapa->dono = (uint8_t*)(bytes + cabecalho->deslocamento_dono);
+    mapa->nomes = (char (*)[NOME_MAX])(bytes + cabecalho->deslocamento_nomes);
+    mapa->fronteiras = (int (*)[2])(bytes + cabecalho->deslocamento_fronteiras);
+    mapa->total_fronteiras = cabecalho->total_fronteiras;
+    mapa->capacidade_fronteiras = cabecalho->total_fronteiras;
+    mapa->mapeamento = base;
+    mapa->tamanho_mapeamento = tamanho;
+
+    mapa->cores.total = cabecalho->total_cores;
+    memcpy(mapa->cores.nomes, cabecalho->nomes_cores, sizeof(mapa->cores.nomes));
+    for (int c = 0; c < MAX_CORES; c++) {
+        mapa->territorios_por_cor[c] = cabecalho->territorios_por_cor[c];
+        mapa->tropas_por_cor[c] = cabecalho->tropas_por_cor[c];
+    }
+    mapa->tropas_total = cabecalho->tropas_total;
+
+    // Ids fora do intervalo indexariam fora dos agregados ou do grafo, e nomes sem
+    // terminador seriam lidos além do campo: recusa o arquivo.
+    int ids_validos = 1;
+    for (int c = 0; c < mapa->cores.total && ids_validos; c++) {
+        ids_validos = memchr(mapa->cores.nomes[c], 0, COR_MAX) != NULL;
+    }
+    // As somas de tropas são refeitas aqui e comparadas com as do cabeçalho.
+    long long tropas_por_cor[MAX_CORES] = {0};
+    long long tropas_total = 0;
+    for (int i = 0; i < mapa->total && ids_validos; i++) {
+        ids_validos = mapa->dono[i] < mapa->cores.total && mapa->tropas[i] >= 1 &&
+                      memchr(mapa->nomes[i], 0, NOME_MAX) != NULL;
+        if (ids_validos) {
+            tropas_por_cor[mapa->dono[i]] += mapa->tropas[i];
+            tropas_total += mapa->tropas[i];
+        }
+    }
+    ids_validos = ids_validos && tropas_total == mapa->tropas_total &&
+                  memcmp(tropas_por_cor, mapa->tropas_por_cor, sizeof(tropas_por_cor)) == 0;
+    for (long f = 0; f < mapa->total_fronteiras && ids_validos; f++) {
+        ids_validos = mapa->fronteiras[f][0] >= 0 && mapa->fronteiras[f][0] < mapa->total &&
+                      mapa->fronteiras[f][1] >= 0 && mapa->fronteiras[f][1] < mapa->total &&
+                      mapa->fronteiras[f][0] != mapa->fronteiras[f][1];
+    }
+    // ordem_por_cor não vai no arquivo: é remontada dos donos, e os agregados
+    // gravados precisam bater com a contagem.
+    mapa->ordem_por_cor = (int*)arenaAlocar(arena, (size_t)(mapa->total > 0 ? mapa->total : 1) * sizeof(int));
+    mapa->posicao_na_ordem = (int*)arenaAlocar(arena, (size_t)(mapa->total > 0 ? mapa->total : 1) * sizeof(int));
+    if (!ids_validos || mapa->ordem_por_cor == NULL || mapa->posicao_na_ordem == NULL ||
+        prepararRascunho(mapa, mapa->total) != 0 || reconstruirOrdemPorCor(mapa) != 0) {
+        munmap(base, tamanho);
+        return NULL;
+    }
+
+    missao->indice = cabecalho->missao_indice;
+    missao->cor = -1; // o menu é de um jogador só
+    missao->tipo = (TipoMissao)cabecalho->missao_tipo;
+    missao->descricao = NULL;
+    missao->quantidade = cabecalho->missao_quantidade;
+    missao->cor_alvo = cabecalho->missao_cor_alvo;
+    missao->id_territorio_alvo = cabecalho->missao_id_territorio_alvo;
+    memcpy(missao->territorio_alvo, cabecalho->missao_territorio_alvo, NOME_MAX);
+    missao->territorio_alvo[NOME_MAX - 1] = 0;
+    memcpy(gerador->estado, cabecalho->estado_gerador, sizeof(gerador->estado));
+
+    // O grafo CSR é derivado: montado em O(V + E) a partir da lista de fronteiras.
+    if (atualizarGrafo(mapa) != 0) {
+        munmap(base, tamanho);
+        return NULL;
+    }
+    return mapa;
+}
+
+/**
+ * @brief Abre um snapshot com mmap e monta o mapa apontando direto para ele.
+ * O mapeamento é privado (copy-on-write): alterações do jogo não tocam no arquivo.
+ * A estrutura Mapa vem da arena; o mapeamento é desfeito por liberarMemoria().
+ * @param missao Recebe a missão salva (descricao fica NULL; o chamador resolve pelo catálogo).
+ * @param gerador Recebe o estado salvo do gerador.
+ * @return Mapa carregado ou NULL se o arquivo for inválido.
+ */
+Mapa* carregarSnapshot(const char* caminho, Arena* arena, Missao* missao, GeradorAleatorio* gerador) {
+    uint64_t inicio = iniciarIntervalo();
+    Mapa* mapa = abrirSnapshot(caminho, arena, missao, gerador);
+    if (mapa != NULL) contar(CONTADOR_BYTES_LIDOS, (long long)mapa->tamanho_mapeamento);
+    encerrarIntervalo(INTERVALO_CARREGAR_SNAPSHOT, inicio);
+    return mapa;
+}
+
+/**
+ * @brief Pergunta o nome do arquivo e salva o jogo atual.
+ */
+void salvarJogo(const Mapa* mapa, const Missao* missao, const GeradorAleatorio* gerador) {
+    char caminho[CAMINHO_MAX];
+
+    printf("\nNome do arquivo para salvar (Ex: jogo.war): ");
+    if (fgets(caminho, CAMINHO_MAX, stdin) == NULL) return;
+    caminho[strcspn(caminho, "\n")] = 0;
+    if (caminho[0] == 0) {
+        printf("Nome de arquivo inválido.\n");
+        return;
+    }
+
+    double inicio = tempoAtualSegundos();
+    if (salvarSnapshot(caminho, mapa, missao, gerador) != 0) {
+        perror("Erro ao salvar o jogo");
+        return;
+    }
+    printf("Jogo salvo em '%s' (%d territórios, %.2f ms).\n", caminho, mapa->total,
+           (tempoAtualSegundos() - inicio) * 1000.0);
+}
+
+// --- Importação de Cenários (CSV) ---
+
+/**
+ * @brief Remove espaços e tabulações das pontas do intervalo [*inicio, *fim).
+ */
+static void aparar(const char** inicio, const char** fim) {
+    while (*inicio < *fim && (**inicio == ' ' || **inicio == '\t')) (*inicio)++;
+    while (*fim > *inicio && ((*fim)[-1] == ' ' || (*fim)[-1] == '\t' || (*fim)[-1] == '\r')) (*fim)--;
+}
+
+// Fronteira lida do arquivo; os nomes só são resolvidos no fim, quando todos
+// os territórios já existem.
+struct FronteiraPendente {
+    char a[NOME_MAX];
+    char b[NOME_MAX];
+    long linha;
+};
+
+// Estado de uma importação em andamento.
+struct Importacao {
+    Mapa* mapa;
+    const char* caminho;
+    EstatisticasImportacao* estatisticas;
+    struct FronteiraPendente* pendentes;
+    long total_pendentes;
+    long capacidade_pendentes;
+};
+
+static void relatarErroImportacao(struct Importacao* imp, long linha, const char* motivo) {
+    imp->estatisticas->erros++;
+    if (imp->estatisticas->erros <= IMPORTACAO_MAX_ERROS) {
+        fprintf(stderr, "%s:%ld: %s\n", imp->caminho, linha, motivo);
+    }
+}
+
+/**
+ * @brief Guarda uma linha "@nome_a,nome_b" para ser resolvida no fim da importação.
+ */
+static void importarFronteira(const char* linha, const char* fim, struct Importacao* imp) {
+    long numero = imp->estatisticas->linhas;
+    const char* virgula = (const char*)memchr(linha, ',', (size_t)(fim - linha));
+    if (virgula == NULL || memchr(virgula + 1, ',', (size_t)(fim - virgula - 1)) != NULL) {
+        relatarErroImportacao(imp, numero, "esperado '@nome_a,nome_b'");
+        return;
+    }
+
+    const char* a0 = linha;
+    const char* a1 = virgula;
+    const char* b0 = virgula + 1;
+    const char* b1 = fim;
+    aparar(&a0, &a1);
+    aparar(&b0, &b1);
+    if (a1 == a0 || b1 == b0 || a1 - a0 >= NOME_MAX || b1 - b0 >= NOME_MAX) {
+        relatarErroImportacao(imp, numero, "nome de território vazio ou longo demais na fronteira");
+        return;
+    }
+
+    if (imp->total_pendentes == imp->capacidade_pendentes) {
+        long nova = imp->capacidade_pendentes > 0 ? imp->capacidade_pendentes * 2 : CAPACIDADE_INICIAL;
+        struct FronteiraPendente* maior = (struct FronteiraPendente*)realocar(imp->pendentes, (size_t)nova * sizeof(*maior));
+        if (maior == NULL) {
+            relatarErroImportacao(imp, numero, "memória insuficiente");
+            return;
+        }
+        imp->pendentes = maior;
+        imp->capacidade_pendentes = nova;
+    }
+
+    struct FronteiraPendente* f = &imp->pendentes[imp->total_pendentes++];
+    memcpy(f->a, a0, (size_t)(a1 - a0));
+    f->a[a1 - a0] = 0;
+    memcpy(f->b, b0, (size_t)(b1 - b0));
+    f->b[b1 - b0] = 0;
+    f->linha = numero;
+}
+
+/**
+ * @brief Resolve os nomes das fronteiras pendentes pelo índice de nomes do mapa
+ * e as cadastra. Nomes desconhecidos são relatados com a linha de origem.
+ */
+static void resolverFronteiras(struct Importacao* imp) {
+    Mapa* mapa = imp->mapa;
+    for (long k = 0; k < imp->total_pendentes; k++) {
+        const struct FronteiraPendente* f = &imp->pendentes[k];
+        int a = buscarTerritorio(mapa, f->a);
+        int b = buscarTerritorio(mapa, f->b);
+        if (a < 0 || b < 0) {
+            relatarErroImportacao(imp, f->linha, "fronteira com território não cadastrado");
+        } else if (adicionarFronteira(mapa, a, b) != 0) {
+            relatarErroImportacao(imp, f->linha, "fronteira inválida (mesmo território) ou memória insuficiente");
+        } else {
+            imp->estatisticas->fronteiras++;
+        }
+    }
+}
+
+/**
+ * @brief Interpreta uma linha "nome,cor,tropas" e acrescenta o território ao mapa.
+ * Linhas "@nome_a,nome_b" declaram uma fronteira. Linhas vazias, comentários (#)
+ * e o cabeçalho "nome,cor,tropas" são ignorados.
+ */
+static void importarLinha(const char* linha, const char* fim, struct Importacao* imp) {
+    Mapa* mapa = imp->mapa;
+    EstatisticasImportacao* estatisticas = imp->estatisticas;
+    const char* campos[3][2];
+    int n = 0;
+
+    aparar(&linha, &fim);
+    if (linha == fim || *linha == '#') return;
+    if (*linha == '@') {
+        importarFronteira(linha + 1, fim, imp);
+        return;
+    }
+
+    const char* atual = linha;
+    while (n < 3) {
+        const char* virgula = (const char*)memchr(atual, ',', (size_t)(fim - atual));
+        campos[n][0] = atual;
+        campos[n][1] = (virgula != NULL) ? virgula : fim;
+        aparar(&campos[n][0], &campos[n][1]);
+        n++;
+        if (virgula == NULL) break;
+        atual = virgula + 1;
+    }
+    if (n != 3 || memchr(campos[2][0], ',', (size_t)(campos[2][1] - campos[2][0])) != NULL) {
+        relatarErroImportacao(imp, estatisticas->linhas, "esperado 'nome,cor,tropas'");
+        return;
+    }
+
+    size_t tamanho_nome = (size_t)(campos[0][1] - campos[0][0]);
+    size_t tamanho_cor = (size_t)(campos[1][1] - campos[1][0]);
+    if (tamanho_nome == 0 || tamanho_nome >= NOME_MAX) {
+        relatarErroImportacao(imp, estatisticas->linhas, "nome vazio ou longo demais");
+        return;
+    }
+    if (tamanho_cor == 0 || tamanho_cor >= COR_MAX) {
+        relatarErroImportacao(imp, estatisticas->linhas, "cor vazia ou longa demais");
+        return;
+    }
+
+    long tropas = 0;
+    const char* p = campos[2][0];
+    for (; p < campos[2][1] && *p >= '0' && *p <= '9' && tropas <= INT32_MAX; p++) {
+        tropas = tropas * 10 + (*p - '0');
+    }
+    if (p != campos[2][1] || p == campos[2][0] || tropas < 1 || tropas > INT32_MAX) {
+        if (estatisticas->linhas == 1 && campos[2][1] - campos[2][0] == 6 && strncmp(campos[2][0], "tropas", 6) == 0) {
+            return; // cabeçalho
+        }
+        relatarErroImportacao(imp, estatisticas->linhas, "quantidade de tropas inválida (inteiro >= 1)");
+        return;
+    }
+
+    char nome[NOME_MAX];
+    char cor[COR_MAX];
+    memcpy(nome, campos[0][0], tamanho_nome);
+    nome[tamanho_nome] = 0;
+    memcpy(cor, campos[1][0], tamanho_cor);
+    cor[tamanho_cor] = 0;
+
+    if (garantirCapacidade(mapa, mapa->total + 1) != 0) {
+        relatarErroImportacao(imp, estatisticas->linhas, "memória insuficiente");
+        return;
+    }
+    if (adicionarTerritorio(mapa, nome, cor, (int)tropas) < 0) {
+        relatarErroImportacao(imp, estatisticas->linhas, "limite de cores diferentes atingido");
+        return;
+    }
+    estatisticas->importados++;
+}
+
+static int lerCenario(const char* caminho, Mapa* mapa, EstatisticasImportacao* estatisticas) {
+    memset(estatisticas, 0, sizeof(*estatisticas));
+    double inicio = tempoAtualSegundos();
+
+    struct Importacao imp;
+    memset(&imp, 0, sizeof(imp));
+    imp.mapa = mapa;
+    imp.caminho = caminho;
+    imp.estatisticas = estatisticas;
+
+    int fd = open(caminho, O_RDONLY);
+    if (fd < 0) return -1;
+
+    // O buffer guarda o pedaço de linha que sobrou do bloco anterior + o bloco novo.
+    size_t capacidade = 2 * IMPORTACAO_BLOCO;
+    char* buffer = (char*)alocar(capacidade);
+    if (buffer == NULL) {
+        close(fd);
+        return -1;
+    }
+
+    size_t pendente = 0;
+    int resultado = 0;
+    for (;;) {
+        if (capacidade - pendente < IMPORTACAO_BLOCO) {
+            // Linha maior que um bloco: aumenta o buffer para caber o próximo bloco.
+            char* maior = (char*)realocar(buffer, capacidade * 2);
+            if (maior == NULL) {
+                resultado = -1;
+                break;
+            }
+            buffer = maior;
+            capacidade *= 2;
+        }
+
+        ssize_t lidos = read(fd, buffer + pendente, IMPORTACAO_BLOCO);
+        if (lidos < 0) {
+            resultado = -1;
+            break;
+        }
+        estatisticas->bytes += lidos;
+        contar(CONTADOR_BYTES_LIDOS, lidos);
+
+        size_t disponivel = pendente + (size_t)lidos;
+        char* linha = buffer;
+        char* fim_dados = buffer + disponivel;
+        char* quebra;
+        while ((quebra = (char*)memchr(linha, '\n', (size_t)(fim_dados - linha))) != NULL) {
+            estatisticas->linhas++;
+            importarLinha(linha, quebra, &imp);
+            linha = quebra + 1;
+        }
+
+        pendente = (size_t)(fim_dados - linha);
+        if (lidos == 0) {
+            if (pendente > 0) { // última linha sem '\n'
+                estatisticas->linhas++;
+                importarLinha(linha, fim_dados, &imp);
+            }
+            break;
+        }
+        memmove(buffer, linha, pendente);
+    }
+
+    free(buffer);
+    close(fd);
+
+    resolverFronteiras(&imp);
+    free(imp.pendentes);
+    if (resultado == 0 && atualizarGrafo(mapa) != 0) {
+        resultado = -1;
+    }
+    estatisticas->segundos = tempoAtualSegundos() - inicio;
+    if (estatisticas->erros > IMPORTACAO_MAX_ERROS) {
+        fprintf(stderr, "%s: mais %ld linhas com erro não exibidas.\n", caminho,
+                estatisticas->erros - IMPORTACAO_MAX_ERROS);
+    }
+    return resultado;
+}
+
+/**
+ * @brief Lê um cenário CSV (uma linha "nome,cor,tropas" por território e uma
+ * "@nome_a,nome_b" por fronteira) em blocos de IMPORTACAO_BLOCO bytes, crescendo
+ * o mapa conforme necessário. No fim, monta o grafo de fronteiras.
+ * Linhas com erro são relatadas com o número da linha e puladas.
+ * @return 0 se o arquivo foi lido até o fim, -1 em erro de leitura (errno preenchido).
+ */
+int importarCenario(const char* caminho, Mapa* mapa, EstatisticasImportacao* estatisticas) {
+    uint64_t inicio = iniciarIntervalo();
+    int resultado = lerCenario(caminho, mapa, estatisticas);
+    encerrarIntervalo(INTERVALO_IMPORTAR_CENARIO, inicio);
+    return resultado;
+}
+
+
+// --- Registro de Eventos e Replay (--gravar / --replay) ---
+
+static const char* NOMES_EVENTOS[TOTAL_EVENTOS] = {
+    "?", "gerador", "território", "fronteira", "missão", "rodada", "relâmpago", "fim"
+};
+
+static uint64_t misturarHash(uint64_t hash, const void* dados, size_t tamanho) {
+    const unsigned char* bytes = (const unsigned char*)dados;
+    for (size_t i = 0; i < tamanho; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL; // FNV-1a
+    }
+    return hash;
+}
+
+/**
+ * @brief Hash (FNV-1a, 64 bits) do estado da partida: territórios (nome, nome da
+ * cor, tropas), fronteiras e estado do gerador. Usa os nomes das cores, não os
+ * ids, para não depender da ordem em que as cores foram internadas.
+ */
+uint64_t hashEstado(const Mapa* mapa, const GeradorAleatorio* gerador) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (int i = 0; i < mapa->total; i++) {
+        const char* cor = nomeDaCor(mapa, mapa->dono[i]);
+        hash = misturarHash(hash, mapa->nomes[i], strnlen(mapa->nomes[i], NOME_MAX) + 1);
+        hash = misturarHash(hash, cor, strlen(cor) + 1);
+        hash = misturarHash(hash, &mapa->tropas[i], sizeof(int));
+    }
+    for (long f = 0; f < mapa->total_fronteiras; f++) {
+        hash = misturarHash(hash, mapa->fronteiras[f], sizeof(int[2]));
+    }
+    return misturarHash(hash, gerador->estado, sizeof(gerador->estado));
+}
+
+static void anexarVarint(SaidaBuffer* saida, uint64_t valor) {
+    char bytes[10];
+    size_t n = 0;
+    do {
+        bytes[n] = (char)(valor & 0x7F);
+        valor >>= 7;
+        if (valor != 0) bytes[n] |= (char)0x80;
+        n++;
+    } while (valor != 0);
+    anexarBytes(saida, bytes, n);
+}
+
+static void anexarTextoCurto(SaidaBuffer* saida, const char* texto, size_t maximo) {
+    size_t tamanho = strnlen(texto, maximo);
+    anexarVarint(saida, tamanho);
+    anexarBytes(saida, texto, tamanho);
+}
+
+static void iniciarEvento(TipoEvento tipo) {
+    char byte = (char)tipo;
+    anexarBytes(registro.saida, &byte, 1);
+    registro.eventos++;
+}
+
+/**
+ * @brief Abre o registro da partida: cabeçalho (mágica, versão, semente) e, daí
+ * em diante, um evento por mudança no estado, montados em blocos no SaidaBuffer.
+ * @return 0 em caso de sucesso, -1 se o arquivo não pôde ser criado.
+ */
+int iniciarRegistro(const char* caminho, uint64_t semente) {
+    FILE* arquivo = fopen(caminho, "wb");
+    if (arquivo == NULL) return -1;
+    registro.saida = (SaidaBuffer*)alocar(sizeof(SaidaBuffer));
+    if (registro.saida == NULL) {
+        fclose(arquivo);
+        return -1;
+    }
+    iniciarSaida(registro.saida, arquivo);
+    registro.caminho = caminho;
+    registro.eventos = 0;
+
+    char versao = REGISTRO_VERSAO;
+    anexarBytes(registro.saida, REGISTRO_MAGICA, sizeof(REGISTRO_MAGICA));
+    anexarBytes(registro.saida, &versao, 1);
+    anexarVarint(registro.saida, semente);
+    return 0;
+}
+
+/**
+ * @brief Grava o ponto de partida (gerador, mapa e missão), venha ele de um jogo
+ * novo, de um cenário ou de um snapshot: o replay não precisa dos arquivos originais.
+ */
+void registrarEstadoInicial(const Mapa* mapa, const Missao* missao, const GeradorAleatorio* gerador) {
+    if (registro.saida == NULL) return;
+    iniciarEvento(EVENTO_GERADOR);
+    for (int k = 0; k < 4; k++) {
+        anexarVarint(registro.saida, gerador->estado[k]);
+    }
+    for (int i = 0; i < mapa->total; i++) {
+        registrarTerritorio(mapa, i);
+    }
+    for (long f = 0; f < mapa->total_fronteiras; f++) {
+        registrarFronteira(mapa->fronteiras[f][0], mapa->fronteiras[f][1]);
+    }
+    iniciarEvento(EVENTO_MISSAO);
+    anexarVarint(registro.saida, (uint64_t)missao->indice);
+}
+
+void registrarTerritorio(const Mapa* mapa, int id) {
+    if (registro.saida == NULL) return;
+    iniciarEvento(EVENTO_TERRITORIO);
+    anexarTextoCurto(registro.saida, mapa->nomes[id], NOME_MAX);
+    anexarTextoCurto(registro.saida, nomeDaCor(mapa, mapa->dono[id]), COR_MAX);
+    anexarVarint(registro.saida, (uint64_t)mapa->tropas[id]);
+}
+
+void registrarFronteira(int a, int b) {
+    if (registro.saida == NULL) return;
+    iniciarEvento(EVENTO_FRONTEIRA);
+    anexarVarint(registro.saida, (uint64_t)a);
+    anexarVarint(registro.saida, (uint64_t)b);
+}
+
+/**
+ * @brief Grava uma rodada de atacar(): o par de territórios e os dados sorteados
+ * (as perdas e a conquista saem dos dados no replay).
+ */
+void registrarRodada(int id_atacante, int id_defensor, const RodadaCombate* rodada) {
+    if (registro.saida == NULL) return;
+    iniciarEvento(EVENTO_RODADA);
+    anexarVarint(registro.saida, (uint64_t)id_atacante);
+    anexarVarint(registro.saida, (uint64_t)id_defensor);
+
+    unsigned faces = 0;
+    int bit = 0;
+    for (int i = 0; i < rodada->num_ataque; i++, bit += 3) faces |= (unsigned)(rodada->dados_ataque[i] - 1) << bit;
+    for (int i = 0; i < rodada->num_defesa; i++, bit += 3) faces |= (unsigned)(rodada->dados_defesa[i] - 1) << bit;
+    char bytes[3] = {(char)(rodada->num_ataque | rodada->num_defesa << 2), (char)(faces & 0xFF), (char)(faces >> 8)};
+    anexarBytes(registro.saida, bytes, sizeof(bytes));
+}
+
+/**
+ * @brief Grava um ataque relâmpago: o par de territórios e as tropas de cada um
+ * depois da batalha.
+ */
+void registrarRelampago(const Mapa* mapa, int id_atacante, int id_defensor) {
+    if (registro.saida == NULL) return;
+    iniciarEvento(EVENTO_RELAMPAGO);
+    anexarVarint(registro.saida, (uint64_t)id_atacante);
+    anexarVarint(registro.saida, (uint64_t)id_defensor);
+    anexarVarint(registro.saida, (uint64_t)mapa->tropas[id_atacante]);
+    anexarVarint(registro.saida, (uint64_t)mapa->tropas[id_defensor]);
+}
+
+/**
+ * @brief Fecha o registro com o hash do estado final e o resultado da missão.
+ * Sem mapa (a partida nem começou), só fecha o arquivo.
+ */
+void encerrarRegistro(const Mapa* mapa, const Missao* missao, const GeradorAleatorio* gerador) {
+    SaidaBuffer* saida = registro.saida;
+    if (saida == NULL) return;
+
+    if (mapa != NULL) {
+        uint64_t hash = hashEstado(mapa, gerador);
+        char fim[9];
+        for (int k = 0; k < 8; k++) fim[k] = (char)(hash >> (8 * k));
+        fim[8] = (char)(atualizarGrafo((Mapa*)mapa) == 0 && verificarMissao(missao, mapa));
+        iniciarEvento(EVENTO_FIM);
+        anexarBytes(saida, fim, sizeof(fim));
+        printf("\nPartida gravada em '%s' (%lld eventos, hash %016llx).\n", registro.caminho, registro.eventos,
+               (unsigned long long)hash);
+    }
+    descarregarSaida(saida);
+    if (fclose(saida->destino) != 0) perror("Erro ao gravar o registro da partida");
+    free(saida);
+    registro.saida = NULL;
+}
+
+// Leitura de um registro mapeado em memória.
+struct LeitorEventos {
+    const unsigned char* atual;
+    const unsigned char* fim;
+    int erro;
+};
+
+static uint64_t lerVarint(struct LeitorEventos* leitor) {
+    uint64_t valor = 0;
+    for (int deslocamento = 0; deslocamento < 64; deslocamento += 7) {
+        if (leitor->atual == leitor->fim) break;
+        unsigned char byte = *leitor->atual++;
+        valor |= (uint64_t)(byte & 0x7F) << deslocamento;
+        if ((byte & 0x80) == 0) return valor;
+    }
+    leitor->erro = 1;
+    return 0;
+}
+
+static const unsigned char* lerBytes(struct LeitorEventos* leitor, size_t tamanho) {
+    if ((size_t)(leitor->fim - leitor->atual) < tamanho) {
+        leitor->erro = 1;
+        return NULL;
+    }
+    const unsigned char* bytes = leitor->atual;
+    leitor->atual += tamanho;
+    return bytes;
+}
+
+static void lerTextoCurto(struct LeitorEventos* leitor, char* destino, size_t maximo) {
+    uint64_t tamanho = lerVarint(leitor);
+    const unsigned char* bytes = (tamanho < maximo) ? lerBytes(leitor, (size_t)tamanho) : NULL;
+    if (bytes == NULL) {
+        leitor->erro = 1;
+        destino[0] = 0;
+        return;
+    }
+    memcpy(destino, bytes, (size_t)tamanho);
+    destino[tamanho] = 0;
+}
+
+// Resultado de uma execução do replay.
+struct ResultadoReplay {
+    long long eventos;
+    long long ataques;
+    int completo;        // chegou ao evento de fim
+    uint64_t hash;
+    int missao_cumprida;
+};
+
+/**
+ * @brief Confere se um ataque gravado ainda é válido no estado reconstruído
+ * (as mesmas regras de iniciarAtaque()).
+ */
+static int ataqueValido(Mapa* mapa, int id_atacante, int id_defensor) {
+    return motivoAtaqueInvalido(mapa, id_atacante, id_defensor) == NULL;
+}
+
+/**
+ * @brief Executa os eventos de um registro sobre um mapa vazio, sem prompts nem
+ * relato, conferindo dados e tropas de cada ataque com os gravados.
+ * @return 0 se tudo confere, -1 na primeira divergência ou erro (já relatados).
+ */
+static int reproduzirEventos(struct LeitorEventos* leitor, Mapa* mapa, Missao* missao, GeradorAleatorio* gerador,
+                             struct ResultadoReplay* resultado) {
+    const char* divergencia = NULL;
+    int tipo = 0;
+    int missao_definida = 0;
+
+    while (leitor->atual < leitor->fim && divergencia == NULL && !leitor->erro && !resultado->completo) {
+        tipo = *leitor->atual++;
+        resultado->eventos++;
+
+        if (tipo == EVENTO_GERADOR) {
+            for (int k = 0; k < 4; k++) gerador->estado[k] = lerVarint(leitor);
+        } else if (tipo == EVENTO_TERRITORIO) {
+            char nome[NOME_MAX];
+            char cor[COR_MAX];
+            lerTextoCurto(leitor, nome, NOME_MAX);
+            lerTextoCurto(leitor, cor, COR_MAX);
+            uint64_t tropas = lerVarint(leitor);
+            if (leitor->erro || tropas > INT_MAX) break;
+            int id = (garantirCapacidade(mapa, mapa->total + 1) == 0) ? adicionarTerritorio(mapa, nome, cor, (int)tropas) : -1;
+            if (id < 0) {
+                divergencia = "território não pôde ser cadastrado";
+            } else if (missao_definida) {
+                vincularTerritorioMissao(missao, mapa, id);
+            }
+        } else if (tipo == EVENTO_FRONTEIRA) {
+            uint64_t a = lerVarint(leitor);
+            uint64_t b = lerVarint(leitor);
+            if (!leitor->erro && (a > INT_MAX || b > INT_MAX || adicionarFronteira(mapa, (int)a, (int)b) != 0)) {
+                divergencia = "fronteira inválida";
+            }
+        } else if (tipo == EVENTO_MISSAO) {
+            uint64_t indice = lerVarint(leitor);
+            if (!leitor->erro && indice >= (uint64_t)TOTAL_MISSOES_MENU) {
+                divergencia = "missão fora do catálogo";
+            } else if (!leitor->erro) {
+                compilarMissao(missao, MISSOES_MENU, (int)indice, mapa, -1);
+                missao_definida = 1;
+            }
+        } else if (tipo == EVENTO_RODADA) {
+            uint64_t a = lerVarint(leitor);
+            uint64_t d = lerVarint(leitor);
+            const unsigned char* bytes = lerBytes(leitor, 3);
+            if (leitor->erro) break;
+            if (a > INT_MAX || d > INT_MAX || !ataqueValido(mapa, (int)a, (int)d)) {
+                divergencia = "ataque inválido no estado reconstruído";
+                break;
+            }
+            // Mesmos passos de atacar(): sorteia a rodada e aplica ao mapa
+            RodadaCombate rodada;
+            rolarRodada(&rodada, mapa->tropas[a], mapa->tropas[d], gerador);
+            unsigned faces = 0;
+            int bit = 0;
+            for (int i = 0; i < rodada.num_ataque; i++, bit += 3) faces |= (unsigned)(rodada.dados_ataque[i] - 1) << bit;
+            for (int i = 0; i < rodada.num_defesa; i++, bit += 3) faces |= (unsigned)(rodada.dados_defesa[i] - 1) << bit;
+            if (bytes[0] != (rodada.num_ataque | rodada.num_defesa << 2) || bytes[1] != (faces & 0xFF) ||
+                bytes[2] != (faces >> 8)) {
+                divergencia = "dados diferentes dos gravados";
+                break;
+            }
+            aplicarCombate(mapa, (int)a, (int)d, &rodada);
+            resultado->ataques++;
+        } else if (tipo == EVENTO_RELAMPAGO) {
+            uint64_t a = lerVarint(leitor);
+            uint64_t d = lerVarint(leitor);
+            uint64_t tropas_atacante = lerVarint(leitor);
+            uint64_t tropas_defensor = lerVarint(leitor);
+            if (leitor->erro) break;
+            if (a > INT_MAX || d > INT_MAX || !ataqueValido(mapa, (int)a, (int)d)) {
+                divergencia = "ataque inválido no estado reconstruído";
+                break;
+            }
+            // Mesmos passos de atacarAteConquistar()
+            LoteDados lote;
+            iniciarLoteDados(&lote, gerador);
+            aplicarBatalha(mapa, (int)a, (int)d, &lote);
+            if ((uint64_t)mapa->tropas[a] != tropas_atacante || (uint64_t)mapa->tropas[d] != tropas_defensor) {
+                divergencia = "tropas diferentes das gravadas";
+            }
+            resultado->ataques++;
+        } else if (tipo == EVENTO_FIM) {
+            const unsigned char* bytes = lerBytes(leitor, 9);
+            if (leitor->erro) break;
+            uint64_t hash_gravado = 0;
+            for (int k = 0; k < 8; k++) hash_gravado |= (uint64_t)bytes[k] << (8 * k);
+            resultado->hash = hashEstado(mapa, gerador);
+            resultado->missao_cumprida = missao_definida && atualizarGrafo(mapa) == 0 && verificarMissao(missao, mapa);
+            resultado->completo = 1;
+            if (resultado->hash != hash_gravado) {
+                divergencia = "hash do estado final diferente do gravado";
+            } else if (resultado->missao_cumprida != bytes[8]) {
+                divergencia = "resultado da missão diferente do gravado";
+            }
+        } else {
+            divergencia = "tipo de evento desconhecido";
+        }
+    }
+
+    if (leitor->erro) divergencia = "registro truncado ou corrompido";
+    if (divergencia != NULL) {
+        fprintf(stderr, "Replay divergiu no evento %lld (%s): %s.\n", resultado->eventos,
+                (tipo > 0 && tipo < TOTAL_EVENTOS) ? NOMES_EVENTOS[tipo] : "?", divergencia);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Modo --replay: mapeia o registro e o executa 'repeticoes' vezes a toda
+ * velocidade (mapa novo a cada vez), conferindo o hash do estado final.
+ * @return EXIT_SUCCESS se o replay confere com a gravação, EXIT_FAILURE caso contrário.
+ */
+int executarReplay(const char* caminho, long repeticoes) {
+    int fd = open(caminho, O_RDONLY);
+    if (fd < 0) {
+        perror("Erro ao abrir o registro");
+        return EXIT_FAILURE;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size <= sizeof(REGISTRO_MAGICA)) {
+        fprintf(stderr, "Registro inválido: %s\n", caminho);
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    size_t tamanho = (size_t)info.st_size;
+    void* base = mmap(NULL, tamanho, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("Erro ao mapear o registro");
+        return EXIT_FAILURE;
+    }
+
+    const unsigned char* bytes = (const unsigned char*)base;
+    if (memcmp(bytes, REGISTRO_MAGICA, sizeof(REGISTRO_MAGICA)) != 0 || bytes[sizeof(REGISTRO_MAGICA)] != REGISTRO_VERSAO) {
+        fprintf(stderr, "Registro inválido ou de outra versão: %s\n", caminho);
+        munmap(base, tamanho);
+        return EXIT_FAILURE;
+    }
+    struct LeitorEventos cabecalho = {bytes + sizeof(REGISTRO_MAGICA) + 1, bytes + tamanho, 0};
+    uint64_t semente = lerVarint(&cabecalho);
+    if (repeticoes < 1) repeticoes = 1;
+
+    int status = EXIT_SUCCESS;
+    struct ResultadoReplay resultado;
+    Arena arena;
+    iniciarArena(&arena);
+    double inicio = tempoAtualSegundos();
+    for (long r = 0; r < repeticoes && status == EXIT_SUCCESS; r++) {
+        arenaReiniciar(&arena);
+        memset(&resultado, 0, sizeof(resultado));
+        struct LeitorEventos leitor = cabecalho;
+        GeradorAleatorio gerador;
+        Missao missao;
+        iniciarGerador(&gerador, semente, 0);
+        Mapa* mapa = criarMapa(&arena, CAPACIDADE_INICIAL);
+        if (mapa == NULL || reproduzirEventos(&leitor, mapa, &missao, &gerador, &resultado) != 0) {
+            status = EXIT_FAILURE;
+        }
+    }
+    double decorrido = tempoAtualSegundos() - inicio;
+    arenaLiberar(&arena);
+    munmap(base, tamanho);
+    if (status != EXIT_SUCCESS) return status;
+
+    printf("Replay de '%s' (semente %llu): %lld eventos, %lld ataques.\n", caminho, (unsigned long long)semente,
+           resultado.eventos, resultado.ataques);
+    if (resultado.completo) {
+        printf("Estado final confere com a gravação (hash %016llx, missão %s).\n", (unsigned long long)resultado.hash,
+               resultado.missao_cumprida ? "cumprida" : "não cumprida");
+    } else {
+        printf("Registro sem evento de fim (gravação interrompida): estado final não conferido.\n");
+    }
+    printf("%ld repetições em %.3f s (%.0f eventos/s)\n", repeticoes, decorrido,
+           decorrido > 0 ? (double)resultado.eventos * (double)repeticoes / decorrido : 0.0);
+    return EXIT_SUCCESS;
+}
+
+
+// --- Modo Servidor (--servidor / --carga) ---
+
+// Cada conexão é uma sessão com a sua própria partida: mapa, missão e gerador,
+// tudo na arena da sessão. Um único laço epoll atende todas as sessões com
+// sockets não bloqueantes. Os comandos chegam em linhas e são respondidos na
+// ordem; cada resposta começa por uma linha "OK ..." ou "ERRO motivo".
+struct SessaoServidor {
+    int fd;
+    int posicao;                    // índice em Servidor.sessoes (remoção em O(1))
+    uint32_t interesse;             // eventos registrados no epoll
+    int entrada_fechada;            // o cliente fechou o envio
+    int encerrar;                   // fecha assim que a saída pendente for enviada
+    Arena arena;
+    Mapa* mapa;
+    Missao missao;
+    GeradorAleatorio gerador;
+    char entrada[SERVIDOR_ENTRADA]; // bytes recebidos e ainda não processados
+    size_t usado_entrada;
+    char* saida;                    // respostas ainda não enviadas: [inicio_saida, fim_saida)
+    size_t inicio_saida;
+    size_t fim_saida;
+    size_t capacidade_saida;
+};
+
+struct Servidor {
+    int epoll;
+    int escuta;
+    int tcp;
+    uint64_t semente;
+    struct SessaoServidor** sessoes;
+    int ativas;
+    int max_sessoes;
+    long long sessoes_atendidas;
+    long long sessoes_recusadas;
+    long long requisicoes;
+    long long erros;
+};
+
+// Executa um comando; responde OK por conta própria ou devolve o motivo do ERRO.
+typedef const char* (*FuncaoComando)(struct SessaoServidor* sessao, char* argumentos[], int total);
+
+struct ComandoServidor {
+    const char* nome;
+    const char* opcao;   // número equivalente no menu
+    int min_argumentos;
+    int max_argumentos;
+    FuncaoComando executar;
+    const char* uso;
+};
+
+static volatile sig_atomic_t servidor_encerrando;
+
+static void pedirEncerramento(int sinal) {
+    (void)sinal;
+    servidor_encerrando = 1;
+}
+
+/**
+ * @brief Monta o endereço do servidor: só dígitos é uma porta TCP em 127.0.0.1;
+ * qualquer outra coisa é o caminho de um socket Unix.
+ * @return 0 em caso de sucesso, -1 se o endereço for inválido.
+ */
+static int montarEndereco(const char* texto, struct sockaddr_storage* endereco, socklen_t* tamanho) {
+    memset(endereco, 0, sizeof(*endereco));
+    size_t comprimento = strlen(texto);
+    if (comprimento > 0 && strspn(texto, "0123456789") == comprimento) {
+        long porta = strtol(texto, NULL, 10);
+        if (porta < 1 || porta > 65535) return -1;
+        struct sockaddr_in* ipv4 = (struct sockaddr_in*)endereco;
+        ipv4->sin_family = AF_INET;
+        ipv4->sin_port = htons((uint16_t)porta);
+        ipv4->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        *tamanho = sizeof(*ipv4);
+        return 0;
+    }
+    struct sockaddr_un* local = (struct sockaddr_un*)endereco;
+    if (comprimento == 0 || comprimento >= sizeof(local->sun_path)) return -1;
+    local->sun_family = AF_UNIX;
+    memcpy(local->sun_path, texto, comprimento + 1);
+    *tamanho = sizeof(*local);
+    return 0;
+}
+
+/**
+ * @brief Acrescenta texto formatado à saída pendente da sessão, compactando ou
+ * dobrando o buffer quando não cabe. Sem memória, a sessão é encerrada.
+ */
+static void responder(struct SessaoServidor* sessao, const char* formato, ...) __attribute__((format(printf, 2, 3)));
+static void responder(struct SessaoServidor* sessao, const char* formato, ...) {
+    for (;;) {
+        size_t livre = sessao->capacidade_saida - sessao->fim_saida;
+        va_list argumentos;
+        va_start(argumentos, formato);
+        int escritos = vsnprintf(sessao->saida + sessao->fim_saida, livre, formato, argumentos);
+        va_end(argumentos);
+        if (escritos < 0) break;
+        if ((size_t)escritos < livre) {
+            sessao->fim_saida += (size_t)escritos;
+            return;
+        }
+        if (sessao->inicio_saida > 0) {
+            memmove(sessao->saida, sessao->saida + sessao->inicio_saida, sessao->fim_saida - sessao->inicio_saida);
+            sessao->fim_saida -= sessao->inicio_saida;
+            sessao->inicio_saida = 0;
+            continue;
+        }
+        size_t nova = sessao->capacidade_saida * 2;
+        while (nova <= sessao->fim_saida + (size_t)escritos) nova *= 2;
+        char* saida = (char*)realocar(sessao->saida, nova);
+        if (saida == NULL) break;
+        sessao->saida = saida;
+        sessao->capacidade_saida = nova;
+    }
+    sessao->encerrar = 1;
+}
+
+/**
+ * @brief cadastrar nome cor tropas (opção 1): OK id.
+ */
+static const char* comandoCadastrar(struct SessaoServidor* sessao, char* argumentos[], int total) {
+    (void)total;
+    Mapa* mapa = sessao->mapa;
+    char* fim;
+    long tropas = strtol(argumentos[2], &fim, 10);
+    if (fim == argumentos[2] || *fim != 0 || tropas < 1 || tropas > INT_MAX) {
+        return "quantidade de tropas inválida (deve ser um número inteiro >= 1)";
+    }
+    if (strlen(argumentos[0]) >= NOME_MAX) return "nome longo demais";
+    if (strlen(argumentos[1]) >= COR_MAX) return "cor longa demais";
+    if (mapa->total >= SERVIDOR_MAX_TERRITORIOS) return "limite de territórios da sessão atingido";
+    if (garantirCapacidade(mapa, mapa->total + 1) != 0) return "memória insuficiente para um novo território";
+
+    int id = adicionarTerritorio(mapa, argumentos[0], argumentos[1], (int)tropas);
+    if (id < 0) return "limite de cores diferentes atingido";
+    vincularTerritorioMissao(&sessao->missao, mapa, id);
+    responder(sessao, "OK %d\n", id);
+    return NULL;
+}
+
+/**
+ * @brief listar [pagina] (opção 2): OK linhas pagina/paginas, seguida de uma
+ * linha "id nome cor tropas" por território da página.
+ */
+static const char* comandoListar(struct SessaoServidor* sessao, char* argumentos[], int total) {
+    const Mapa* mapa = sessao->mapa;
+    long paginas = mapa->total > 0 ? (mapa->total + EXIBICAO_POR_PAGINA - 1) / EXIBICAO_POR_PAGINA : 1;
+    long pagina = 1;
+    if (total > 0) {
+        char* fim;
+        pagina = strtol(argumentos[0], &fim, 10);
+        if (fim == argumentos[0] || *fim != 0 || pagina < 1 || pagina > paginas) return "página inexistente";
+    }
+
+    int inicio = (int)((pagina - 1) * EXIBICAO_POR_PAGINA);
+    int ultimo = mapa->total - inicio < EXIBICAO_POR_PAGINA ? mapa->total : inicio + EXIBICAO_POR_PAGINA;
+    responder(sessao, "OK %d %ld/%ld\n", ultimo - inicio, pagina, paginas);
+    for (int i = inicio; i < ultimo; i++) {
+        responder(sessao, "%d %s %s %d\n", i, mapa->nomes[i], nomeDaCor(mapa, mapa->dono[i]), mapa->tropas[i]);
+    }
+    return NULL;
+}
+
+/**
+ * @brief atacar atacante defensor [relampago] (opção 3), com ids ou nomes:
+ * OK conquistou tropas_atacante tropas_defensor missao_cumprida.
+ */
+static const char* comandoAtacar(struct SessaoServidor* sessao, char* argumentos[], int total) {
+    Mapa* mapa = sessao->mapa;
+    int relampago = 0;
+    if (total > 2) {
+        if (strcmp(argumentos[2], "relampago") != 0) return "terceiro argumento deve ser 'relampago'";
+        relampago = 1;
+    }
+    int id_atacante = resolverReferenciaTerritorio(mapa, argumentos[0]);
+    int id_defensor = resolverReferenciaTerritorio(mapa, argumentos[1]);
+    const char* motivo = motivoAtaqueInvalido(mapa, id_atacante, id_defensor);
+    if (motivo != NULL) return motivo;
+
+    // Mesmas funções do menu, sem relato: o cliente recebe só o resultado.
+    if (relampago) {
+        atacarAteConquistar(mapa, id_atacante, id_defensor, &sessao->gerador, NULL);
+    } else {
+        atacar(mapa, id_atacante, id_defensor, &sessao->gerador, NULL);
+    }
+    int conquistou = mapa->dono[id_defensor] == mapa->dono[id_atacante];
+    responder(sessao, "OK %d %d %d %d\n", conquistou, mapa->tropas[id_atacante], mapa->tropas[id_defensor],
+              atualizarGrafo(mapa) == 0 && verificarMissao(&sessao->missao, mapa));
+    return NULL;
+}
+
+/**
+ * @brief fronteira a b (opção 5), com ids ou nomes: OK.
+ */
+static const char* comandoFronteira(struct SessaoServidor* sessao, char* argumentos[], int total) {
+    (void)total;
+    Mapa* mapa = sessao->mapa;
+    int a = resolverReferenciaTerritorio(mapa, argumentos[0]);
+    int b = resolverReferenciaTerritorio(mapa, argumentos[1]);
+    if (mapa->total_fronteiras >= SERVIDOR_MAX_FRONTEIRAS) return "limite de fronteiras da sessão atingido";
+    if (adicionarFronteira(mapa, a, b) != 0) return "territórios inválidos (devem estar cadastrados e ser diferentes)";
+    responder(sessao, "OK\n");
+    return NULL;
+}
+
+/**
+ * @brief missao: OK cumprida descrição.
+ */
+static const char* comandoMissao(struct SessaoServidor* sessao, char* argumentos[], int total) {
+    (void)argumentos;
+    (void)total;
+    if (atualizarGrafo(sessao->mapa) != 0) return "memória insuficiente para o grafo de fronteiras";
+    responder(sessao, "OK %d %s\n", verificarMissao(&sessao->missao, sessao->mapa), sessao->missao.descricao);
+    return NULL;
+}
+
+/**
+ * @brief sair (opção 0): OK e a conexão é fechada.
+ */
+static const char* comandoSair(struct SessaoServidor* sessao, char* argumentos[], int total) {
+    (void)argumentos;
+    (void)total;
+    responder(sessao, "OK\n");
+    sessao->encerrar = 1;
+    return NULL;
+}
+
+static const struct ComandoServidor COMANDOS_SERVIDOR[] = {
+    {"cadastrar", "1", 3, 3, comandoCadastrar, "cadastrar nome cor tropas"},
+    {"listar", "2", 0, 1, comandoListar, "listar [pagina]"},
+    {"atacar", "3", 2, 3, comandoAtacar, "atacar atacante defensor [relampago]"},
+    {"fronteira", "5", 2, 2, comandoFronteira, "fronteira territorio territorio"},
+    {"missao", "", 0, 0, comandoMissao, "missao"},
+    {"sair", "0", 0, 0, comandoSair, "sair"},
+};
+
+#define TOTAL_COMANDOS_SERVIDOR ((int)(sizeof(COMANDOS_SERVIDOR) / sizeof(COMANDOS_SERVIDOR[0])))
+
+/**
+ * @brief Separa a linha em palavras e executa o comando. Linhas vazias são ignoradas.
+ */
+static void executarComando(struct Servidor* servidor, struct SessaoServidor* sessao, char* linha) {
+    char* argumentos[SERVIDOR_ARGUMENTOS];
+    int total = 0;
+    char* contexto;
+    for (char* palavra = strtok_r(linha, " \t\r", &contexto); palavra != NULL; palavra = strtok_r(NULL, " \t\r", &contexto)) {
+        if (total < SERVIDOR_ARGUMENTOS) argumentos[total] = palavra;
+        total++;
+    }
+    if (total == 0) return;
+    servidor->requisicoes++;
+
+    const char* motivo = "comando desconhecido (cadastrar, listar, atacar, fronteira, missao, sair)";
+    for (int c = 0; c < TOTAL_COMANDOS_SERVIDOR; c++) {
+        const struct ComandoServidor* comando = &COMANDOS_SERVIDOR[c];
+        if (strcmp(argumentos[0], comando->nome) != 0 && strcmp(argumentos[0], comando->opcao) != 0) continue;
+        if (total - 1 < comando->min_argumentos || total - 1 > comando->max_argumentos) {
+            servidor->erros++;
+            responder(sessao, "ERRO uso: %s\n", comando->uso);
+            return;
+        }
+        motivo = comando->executar(sessao, argumentos + 1, total - 1);
+        break;
+    }
+    if (motivo != NULL) {
+        servidor->erros++;
+        responder(sessao, "ERRO %s\n", motivo);
+    }
+}
+
+static inline size_t saidaPendente(const struct SessaoServidor* sessao) {
+    return sessao->fim_saida - sessao->inicio_saida;
+}
+
+static inline int temLinhaCompleta(const struct SessaoServidor* sessao) {
+    return memchr(sessao->entrada, '\n', sessao->usado_entrada) != NULL;
+}
+
+/**
+ * @brief Executa as linhas completas já recebidas, parando se as respostas
+ * pendentes passarem de SERVIDOR_SAIDA_MAX (o resto espera o cliente ler).
+ */
+static void processarEntrada(struct Servidor* servidor, struct SessaoServidor* sessao) {
+    size_t consumido = 0;
+    while (!sessao->encerrar && saidaPendente(sessao) < SERVIDOR_SAIDA_MAX) {
+        char* linha = sessao->entrada + consumido;
+        char* quebra = (char*)memchr(linha, '\n', sessao->usado_entrada - consumido);
+        if (quebra == NULL) break;
+        *quebra = 0;
+        consumido = (size_t)(quebra - sessao->entrada) + 1;
+        executarComando(servidor, sessao, linha);
+    }
+    if (consumido > 0) {
+        memmove(sessao->entrada, sessao->entrada + consumido, sessao->usado_entrada - consumido);
+        sessao->usado_entrada -= consumido;
+    }
+    if (!sessao->encerrar && sessao->usado_entrada == sizeof(sessao->entrada) && !temLinhaCompleta(sessao)) {
+        servidor->erros++;
+        responder(sessao, "ERRO linha longa demais (máximo de %d bytes)\n", SERVIDOR_ENTRADA - 1);
+        sessao->encerrar = 1;
+    }
+}
+
+/**
+ * @brief Lê o que couber no buffer de entrada (uma chamada por evento).
+ * @return 0 em caso de sucesso, -1 se a conexão falhou.
+ */
+static int lerSessao(struct SessaoServidor* sessao) {
+    size_t livre = sizeof(sessao->entrada) - sessao->usado_entrada;
+    if (livre == 0) return 0;
+    ssize_t lidos = recv(sessao->fd, sessao->entrada + sessao->usado_entrada, livre, 0);
+    if (lidos > 0) {
+        sessao->usado_entrada += (size_t)lidos;
+    } else if (lidos == 0) {
+        sessao->entrada_fechada = 1;
+    } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Envia as respostas pendentes até o socket recusar (EAGAIN).
+ * @return 0 em caso de sucesso, -1 se a conexão falhou.
+ */
+static int enviarSessao(struct SessaoServidor* sessao) {
+    while (saidaPendente(sessao) > 0) {
+        ssize_t enviados = send(sessao->fd, sessao->saida + sessao->inicio_saida, saidaPendente(sessao), MSG_NOSIGNAL);
+        if (enviados < 0) {
+            if (errno == EINTR) continue;
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+        }
+        sessao->inicio_saida += (size_t)enviados;
+    }
+    sessao->inicio_saida = 0;
+    sessao->fim_saida = 0;
+    return 0;
+}
+
+static void liberarSessao(struct SessaoServidor* sessao) {
+    arenaLiberar(&sessao->arena);
+    free(sessao->saida);
+    free(sessao);
+}
+
+static void fecharSessao(struct Servidor* servidor, struct SessaoServidor* sessao) {
+    close(sessao->fd); // também tira o fd do epoll
+    struct SessaoServidor* ultima = servidor->sessoes[--servidor->ativas];
+    ultima->posicao = sessao->posicao;
+    servidor->sessoes[sessao->posicao] = ultima;
+    liberarSessao(sessao);
+}
+
+/**
+ * @brief Cria a sessão de uma conexão aceita: partida nova, com a missão sorteada
+ * como no menu. O fluxo do gerador é o nº da sessão, então com --semente a
+ * k-ésima conexão sempre recebe a mesma partida.
+ * @return Sessão registrada no epoll, ou NULL se faltar memória.
+ */
+static struct SessaoServidor* abrirSessao(struct Servidor* servidor, int fd) {
+    struct SessaoServidor* sessao = (struct SessaoServidor*)alocarZerado(1, sizeof(struct SessaoServidor));
+    if (sessao == NULL) return NULL;
+    sessao->fd = fd;
+    iniciarArena(&sessao->arena);
+    iniciarGerador(&sessao->gerador, servidor->semente, (uint64_t)servidor->sessoes_atendidas);
+    sessao->saida = (char*)alocar(SERVIDOR_SAIDA_INICIAL);
+    sessao->capacidade_saida = SERVIDOR_SAIDA_INICIAL;
+    sessao->mapa = criarMapa(&sessao->arena, CAPACIDADE_INICIAL);
+    if (sessao->saida == NULL || sessao->mapa == NULL) {
+        liberarSessao(sessao);
+        return NULL;
+    }
+    atribuirMissao(&sessao->missao, MISSOES_MENU, TOTAL_MISSOES_MENU, sessao->mapa, -1, &sessao->gerador);
+
+    sessao->interesse = EPOLLIN;
+    struct epoll_event evento = {.events = EPOLLIN, .data.ptr = sessao};
+    if (epoll_ctl(servidor->epoll, EPOLL_CTL_ADD, fd, &evento) != 0) {
+        liberarSessao(sessao);
+        return NULL;
+    }
+    sessao->posicao = servidor->ativas;
+    servidor->sessoes[servidor->ativas++] = sessao;
+    servidor->sessoes_atendidas++;
+    return sessao;
+}
+
+/**
+ * @brief Aceita todas as conexões na fila. Acima de max_sessoes, a conexão
+ * recebe "ERRO servidor cheio" e é fechada.
+ */
+static void aceitarSessoes(struct Servidor* servidor) {
+    static const char CHEIO[] = "ERRO servidor cheio\n";
+    for (;;) {
+        int fd = accept(servidor->escuta, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("Erro ao aceitar conexão");
+            return;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+        if (servidor->tcp) {
+            int ligado = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &ligado, sizeof(ligado));
+        }
+        if (servidor->ativas >= servidor->max_sessoes || abrirSessao(servidor, fd) == NULL) {
+            (void)send(fd, CHEIO, sizeof(CHEIO) - 1, MSG_NOSIGNAL);
+            close(fd);
+            servidor->sessoes_recusadas++;
+        }
+    }
+}
+
+/**
+ * @brief Atualiza os eventos da sessão no epoll: leitura enquanto houver espaço
+ * e as respostas não estiverem acumulando; escrita só com respostas pendentes.
+ */
+static int atualizarInteresse(struct Servidor* servidor, struct SessaoServidor* sessao) {
+    uint32_t interesse = 0;
+    if (!sessao->encerrar && !sessao->entrada_fechada && saidaPendente(sessao) < SERVIDOR_SAIDA_MAX &&
+        sessao->usado_entrada < sizeof(sessao->entrada)) {
+        interesse |= EPOLLIN;
+    }
+    if (saidaPendente(sessao) > 0) interesse |= EPOLLOUT;
+    if (interesse == sessao->interesse) return 0;
+
+    struct epoll_event evento = {.events = interesse, .data.ptr = sessao};
+    if (epoll_ctl(servidor->epoll, EPOLL_CTL_MOD, sessao->fd, &evento) != 0) return -1;
+    sessao->interesse = interesse;
+    return 0;
+}
+
+/**
+ * @brief Trata os eventos de uma sessão: lê, executa as linhas completas e
+ * envia as respostas, repetindo enquanto o socket aceitar tudo.
+ */
+static void atenderSessao(struct Servidor* servidor, struct SessaoServidor* sessao, uint32_t eventos) {
+    // HUP sem nada a ler: o cliente já fechou os dois sentidos.
+    int falhou = (eventos & EPOLLERR) || ((eventos & EPOLLHUP) && !(eventos & EPOLLIN));
+    if (falhou || ((eventos & EPOLLIN) && lerSessao(sessao) != 0)) {
+        fecharSessao(servidor, sessao);
+        return;
+    }
+    for (;;) {
+        processarEntrada(servidor, sessao);
+        if (enviarSessao(sessao) != 0) {
+            fecharSessao(servidor, sessao);
+            return;
+        }
+        if (saidaPendente(sessao) > 0 || sessao->encerrar || !temLinhaCompleta(sessao)) break;
+    }
+    if (sessao->entrada_fechada && !temLinhaCompleta(sessao)) sessao->encerrar = 1;
+    if ((sessao->encerrar && saidaPendente(sessao) == 0) || atualizarInteresse(servidor, sessao) != 0) {
+        fecharSessao(servidor, sessao);
+    }
+}
+
+/**
+ * @brief Modo --servidor: atende sessões em 'endereco' (porta TCP local ou
+ * socket Unix) até receber SIGINT/SIGTERM.
+ * @return EXIT_SUCCESS ao encerrar normalmente, EXIT_FAILURE se não conseguiu abrir o endereço.
+ */
+int executarServidor(const char* endereco, int max_sessoes, uint64_t semente) {
+    struct sockaddr_storage destino;
+    socklen_t tamanho;
+    if (montarEndereco(endereco, &destino, &tamanho) != 0) {
+        fprintf(stderr, "Endereço inválido: %s (porta TCP ou caminho de socket Unix)\n", endereco);
+        return EXIT_FAILURE;
+    }
+    // Cada sessão é um descritor: o limite do processo vale mais que o pedido.
+    struct rlimit limite;
+    if (max_sessoes < 1) max_sessoes = SERVIDOR_SESSOES_PADRAO;
+    if (getrlimit(RLIMIT_NOFILE, &limite) == 0 && limite.rlim_cur != RLIM_INFINITY &&
+        (rlim_t)max_sessoes + 16 > limite.rlim_cur) {
+        max_sessoes = limite.rlim_cur > 32 ? (int)(limite.rlim_cur - 16) : 16;
+        fprintf(stderr, "Aviso: limite de descritores do processo reduz as sessões para %d.\n", max_sessoes);
+    }
+
+    struct Servidor servidor;
+    memset(&servidor, 0, sizeof(servidor));
+    servidor.tcp = destino.ss_family == AF_INET;
+    servidor.semente = semente;
+    servidor.max_sessoes = max_sessoes;
+    servidor.escuta = socket(destino.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (servidor.escuta < 0) {
+        perror("Erro ao criar o socket do servidor");
+        return EXIT_FAILURE;
+    }
+    if (servidor.tcp) {
+        int ligado = 1;
+        setsockopt(servidor.escuta, SOL_SOCKET, SO_REUSEADDR, &ligado, sizeof(ligado));
+    } else {
+        // Um socket que sobrou de uma execução anterior é removido; outro tipo de arquivo, nunca.
+        struct stat info;
+        if (lstat(endereco, &info) == 0 && S_ISSOCK(info.st_mode)) unlink(endereco);
+    }
+    if (bind(servidor.escuta, (struct sockaddr*)&destino, tamanho) != 0 ||
+        listen(servidor.escuta, SERVIDOR_FILA_CONEXOES) != 0) {
+        perror("Erro ao abrir o endereço do servidor");
+        close(servidor.escuta);
+        return EXIT_FAILURE;
+    }
+
+    int status = EXIT_SUCCESS;
+    servidor.sessoes = (struct SessaoServidor**)alocar((size_t)max_sessoes * sizeof(struct SessaoServidor*));
+    servidor.epoll = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event evento = {.events = EPOLLIN, .data.ptr = NULL}; // NULL: socket de escuta
+    if (servidor.sessoes == NULL || servidor.epoll < 0 ||
+        epoll_ctl(servidor.epoll, EPOLL_CTL_ADD, servidor.escuta, &evento) != 0) {
+        perror("Erro ao iniciar o servidor");
+        status = EXIT_FAILURE;
+    }
+
+    // Os sinais de encerramento só são entregues dentro do epoll_pwait(): nenhum
+    // pedido se perde entre o teste da flag e a espera.
+    struct sigaction acao;
+    memset(&acao, 0, sizeof(acao));
+    acao.sa_handler = pedirEncerramento;
+    sigemptyset(&acao.sa_mask);
+    sigaction(SIGINT, &acao, NULL);
+    sigaction(SIGTERM, &acao, NULL);
+    sigset_t bloqueados, original;
+    sigemptyset(&bloqueados);
+    sigaddset(&bloqueados, SIGINT);
+    sigaddset(&bloqueados, SIGTERM);
+    sigprocmask(SIG_BLOCK, &bloqueados, &original);
+
+    if (status == EXIT_SUCCESS) {
+        printf("Servidor em '%s' (até %d sessões). Ctrl+C encerra.\n", endereco, max_sessoes);
+        fflush(stdout);
+    }
+    double inicio = tempoAtualSegundos();
+    struct epoll_event eventos[SERVIDOR_EVENTOS];
+    while (status == EXIT_SUCCESS && !servidor_encerrando) {
+        int prontos = epoll_pwait(servidor.epoll, eventos, SERVIDOR_EVENTOS, -1, &original);
+        if (prontos < 0) {
+            if (errno == EINTR) continue;
+            perror("Erro no epoll_wait");
+            break;
+        }
+        for (int i = 0; i < prontos; i++) {
+            if (eventos[i].data.ptr == NULL) {
+                aceitarSessoes(&servidor);
+            } else {
+                atenderSessao(&servidor, (struct SessaoServidor*)eventos[i].data.ptr, eventos[i].events);
+            }
+        }
+    }
+    double decorrido = tempoAtualSegundos() - inicio;
+    sigprocmask(SIG_SETMASK, &original, NULL);
+
+    while (servidor.ativas > 0) fecharSessao(&servidor, servidor.sessoes[servidor.ativas - 1]);
+    if (servidor.epoll >= 0) close(servidor.epoll);
+    close(servidor.escuta);
+    if (!servidor.tcp) unlink(endereco);
+    free(servidor.sessoes);
+    if (status != EXIT_SUCCESS) return status;
+
+    printf("\nServidor encerrado após %.1f s: %lld sessões (%lld recusadas), %lld requisições (%lld com erro).\n",
+           decorrido, servidor.sessoes_atendidas, servidor.sessoes_recusadas, servidor.requisicoes, servidor.erros);
+    return EXIT_SUCCESS;
+}
+
+// Conexão do gerador de carga: uma requisição em voo por vez (laço fechado).
+struct ConexaoCarga {
+    int fd;
+    long enviadas;          // requisições já enviadas, a atual inclusive
+    int listando;           // a requisição atual é um listar (o cabeçalho diz quantas linhas seguem)
+    int atacante;           // a requisição atual é este ataque (-1: não é ataque)
+    int defensor;
+    int cadastrados;        // territórios da sessão (ids 0..cadastrados-1)
+    int ligados;            // territórios já na cadeia de fronteiras
+    // Cópia do mapa da sessão, mantida pelas respostas dos ataques, para que só
+    // sejam sorteados ataques que o servidor aceita.
+    int tropas[CARGA_MAX_TERRITORIOS];
+    uint8_t cor[CARGA_MAX_TERRITORIOS];
+    int linhas_restantes;   // linhas da resposta atual ainda por chegar (-1: falta o cabeçalho)
+    int recusada;           // a resposta atual é ERRO
+    uint64_t inicio_ns;
+    GeradorAleatorio gerador;
+    char entrada[SERVIDOR_ENTRADA];
+    size_t usado;
+};
+
+struct ResultadoCarga {
+    uint64_t* latencias;    // ns, uma por resposta completa: as OK do início, as ERRO do fim
+    long capacidade;
+    long respostas;
+    long long erros;        // respostas ERRO (comandos recusados), não falhas de conexão
+};
+
+static int compararLatencias(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Percentil por posição (nearest-rank) de latências já ordenadas, em µs.
+ */
+static double percentilLatencia(const uint64_t* ordenadas, long total, double fracao) {
+    long posicao = (long)ceil(fracao * (double)total) - 1;
+    if (posicao < 0) posicao = 0;
+    if (posicao >= total) posicao = total - 1;
+    return (double)ordenadas[posicao] / 1000.0;
+}
+
+/**
+ * @brief Ordena e mostra os percentis de um grupo de latências (nada se o grupo estiver vazio).
+ */
+static void exibirLatencias(const char* rotulo, uint64_t* latencias, long total) {
+    if (total == 0) return;
+    qsort(latencias, (size_t)total, sizeof(uint64_t), compararLatencias);
+    printf("Latência %-4s (µs): p50 %.1f | p90 %.1f | p99 %.1f | p99.9 %.1f | máx %.1f\n", rotulo,
+           percentilLatencia(latencias, total, 0.50), percentilLatencia(latencias, total, 0.90),
+           percentilLatencia(latencias, total, 0.99), percentilLatencia(latencias, total, 0.999),
+           percentilLatencia(latencias, total, 1.0));
+}
+
+/**
+ * @brief Sorteia, entre os pares vizinhos da cadeia, um ataque que o servidor
+ * aceita (cores diferentes, atacante com 2 tropas ou mais) e o guarda na conexão.
+ * @return 1 se havia algum, 0 caso contrário.
+ */
+static int sortearAtaqueCarga(struct ConexaoCarga* conexao) {
+    int validos = 0;
+    for (int i = 0; i + 1 < conexao->ligados; i++) {
+        if (conexao->cor[i] == conexao->cor[i + 1]) continue;
+        validos += (conexao->tropas[i] >= 2) + (conexao->tropas[i + 1] >= 2);
+    }
+    if (validos == 0) return 0;
+
+    int k = (int)sortearLimitado(&conexao->gerador, (uint32_t)validos);
+    for (int i = 0; i + 1 < conexao->ligados; i++) {
+        if (conexao->cor[i] == conexao->cor[i + 1]) continue;
+        if (conexao->tropas[i] >= 2 && k-- == 0) {
+            conexao->atacante = i;
+            conexao->defensor = i + 1;
+            return 1;
+        }
+        if (conexao->tropas[i + 1] >= 2 && k-- == 0) {
+            conexao->atacante = i + 1;
+            conexao->defensor = i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Monta a próxima requisição da conexão. As primeiras cadastram
+ * CARGA_TERRITORIOS territórios de 4 cores e as fronteiras em cadeia; depois
+ * vêm ataques entre vizinhos (a maioria), listagens e consultas da missão.
+ * Quando não sobra ataque válido, um território novo com CARGA_TROPAS entra na
+ * ponta da cadeia (até CARGA_MAX_TERRITORIOS), e os ataques continuam.
+ * @return Tamanho da requisição em bytes.
+ */
+static int montarRequisicao(struct ConexaoCarga* conexao, char* destino, size_t tamanho) {
+    static const char* const CORES[] = {"Azul", "Vermelho", "Verde", "Amarelo"};
+    conexao->listando = 0;
+    conexao->atacante = -1;
+    if (conexao->ligados < conexao->cadastrados) {
+        int b = conexao->ligados++;
+        return snprintf(destino, tamanho, "fronteira %d %d\n", b - 1, b);
+    }
+
+    int reforco = 0;
+    if (conexao->cadastrados >= CARGA_TERRITORIOS) {
+        uint32_t sorteio = sortearLimitado(&conexao->gerador, 100);
+        if (sorteio >= 95) return snprintf(destino, tamanho, "missao\n");
+        if (sorteio >= 75 || (!sortearAtaqueCarga(conexao) && conexao->cadastrados >= CARGA_MAX_TERRITORIOS)) {
+            conexao->listando = 1;
+            return snprintf(destino, tamanho, "listar\n");
+        }
+        if (conexao->atacante >= 0) {
+            return snprintf(destino, tamanho, "atacar %d %d%s\n", conexao->atacante, conexao->defensor,
+                            sorteio < 5 ? " relampago" : "");
+        }
+        reforco = 1;
+    }
+
+    // Cada território novo tem cor diferente da do vizinho na ponta da cadeia.
+    int id = conexao->cadastrados++;
+    int cor = (id == 0) ? 0 : (conexao->cor[id - 1] + 1) % 4;
+    conexao->cor[id] = (uint8_t)cor;
+    conexao->tropas[id] = CARGA_TROPAS;
+    if (id == 0) conexao->ligados = 1;
+    return snprintf(destino, tamanho, "cadastrar %s%d %s %d\n", reforco ? "R" : "T", id, CORES[cor], CARGA_TROPAS);
+}
+
+/**
+ * @brief Envia a próxima requisição e dispara o relógio dela.
+ * @return 0 em caso de sucesso, -1 se o envio falhou.
+ */
+static int enviarRequisicao(struct ConexaoCarga* conexao) {
+    char requisicao[64];
+    int tamanho = montarRequisicao(conexao, requisicao, sizeof(requisicao));
+    conexao->enviadas++;
+    conexao->linhas_restantes = -1;
+    conexao->inicio_ns = relogioNanossegundos();
+    // Só há uma requisição curta em voo: ela sempre cabe inteira no buffer do socket.
+    return send(conexao->fd, requisicao, (size_t)tamanho, MSG_NOSIGNAL) == tamanho ? 0 : -1;
+}
+
+/**
+ * @brief Lê respostas da conexão, mede a latência de cada uma completa e envia a seguinte.
+ * @return 1 quando a conexão concluiu suas requisições, 0 se ainda há o que
+ * esperar, -1 se a conexão falhou ou a resposta não segue o protocolo.
+ */
+static int receberRespostas(struct ConexaoCarga* conexao, long requisicoes, struct ResultadoCarga* resultado) {
+    ssize_t lidos = recv(conexao->fd, conexao->entrada + conexao->usado, sizeof(conexao->entrada) - conexao->usado, 0);
+    if (lidos == 0) return -1;
+    if (lidos < 0) return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    conexao->usado += (size_t)lidos;
+
+    size_t consumido = 0;
+    char* quebra;
+    while ((quebra = (char*)memchr(conexao->entrada + consumido, '\n', conexao->usado - consumido)) != NULL) {
+        char* linha = conexao->entrada + consumido;
+        *quebra = 0;
+        consumido = (size_t)(quebra - conexao->entrada) + 1;
+        if (conexao->linhas_restantes < 0) {
+            conexao->recusada = strncmp(linha, "ERRO", 4) == 0;
+            if (conexao->recusada) {
+                resultado->erros++;
+                conexao->linhas_restantes = 0;
+            } else if (strncmp(linha, "OK", 2) == 0) {
+                conexao->linhas_restantes = conexao->listando ? atoi(linha + 2) : 0;
+                int conquistou, tropas_atacante, tropas_defensor;
+                if (conexao->atacante >= 0 &&
+                    sscanf(linha + 2, "%d %d %d", &conquistou, &tropas_atacante, &tropas_defensor) == 3) {
+                    conexao->tropas[conexao->atacante] = tropas_atacante;
+                    conexao->tropas[conexao->defensor] = tropas_defensor;
+                    if (conquistou) conexao->cor[conexao->defensor] = conexao->cor[conexao->atacante];
+                }
+            } else {
+                return -1;
+            }
+        } else {
+            conexao->linhas_restantes--;
+        }
+        if (conexao->linhas_restantes > 0) continue;
+
+        // OK no início do vetor, ERRO no fim: as latências de cada tipo saem separadas.
+        uint64_t latencia = relogioNanossegundos() - conexao->inicio_ns;
+        if (conexao->recusada) {
+            resultado->latencias[resultado->capacidade - resultado->erros] = latencia;
+        } else {
+            resultado->latencias[resultado->respostas - resultado->erros] = latencia;
+        }
+        resultado->respostas++;
+        if (conexao->enviadas == requisicoes) return 1;
+        if (enviarRequisicao(conexao) != 0) return -1;
+    }
+    memmove(conexao->entrada, conexao->entrada + consumido, conexao->usado - consumido);
+    conexao->usado -= consumido;
+    return conexao->usado < sizeof(conexao->entrada) ? 0 : -1;
+}
+
+/**
+ * @brief Modo --carga: abre 'num_conexoes' sessões no servidor e faz
+ * 'requisicoes' requisições em cada uma, todas ao mesmo tempo (cada conexão
+ * espera a resposta antes de enviar a próxima). Mostra vazão e latências.
+ * @return EXIT_SUCCESS se todas as requisições foram respondidas, EXIT_FAILURE caso contrário.
+ */
+int executarCarga(const char* endereco, int num_conexoes, long requisicoes, uint64_t semente) {
+    struct sockaddr_storage destino;
+    socklen_t tamanho;
+    if (montarEndereco(endereco, &destino, &tamanho) != 0) {
+        fprintf(stderr, "Endereço inválido: %s (porta TCP ou caminho de socket Unix)\n", endereco);
+        return EXIT_FAILURE;
+    }
+    if (num_conexoes < 1 || requisicoes < 1 || requisicoes > LONG_MAX / num_conexoes) {
+        fprintf(stderr, "Conexões e requisições devem ser inteiros >= 1.\n");
+        return EXIT_FAILURE;
+    }
+
+    struct ResultadoCarga resultado = {0};
+    long total = (long)num_conexoes * requisicoes;
+    resultado.latencias = (uint64_t*)alocar((size_t)total * sizeof(uint64_t));
+    resultado.capacidade = total;
+    struct ConexaoCarga* conexoes = (struct ConexaoCarga*)alocarZerado((size_t)num_conexoes, sizeof(struct ConexaoCarga));
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    int abertas = 0;
+    int status = EXIT_SUCCESS;
+    if (resultado.latencias == NULL || conexoes == NULL || epoll < 0) {
+        perror("Erro ao preparar a carga");
+        status = EXIT_FAILURE;
+    }
+
+    // Conexões abertas antes do relógio: a medida é só das requisições.
+    for (int i = 0; status == EXIT_SUCCESS && i < num_conexoes; i++) {
+        struct ConexaoCarga* conexao = &conexoes[i];
+        conexao->fd = socket(destino.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (conexao->fd >= 0) abertas++;
+        if (conexao->fd < 0 || connect(conexao->fd, (struct sockaddr*)&destino, tamanho) != 0) {
+            perror("Erro ao conectar ao servidor");
+            status = EXIT_FAILURE;
+            break;
+        }
+        int ligado = 1;
+        if (destino.ss_family == AF_INET) setsockopt(conexao->fd, IPPROTO_TCP, TCP_NODELAY, &ligado, sizeof(ligado));
+        fcntl(conexao->fd, F_SETFL, fcntl(conexao->fd, F_GETFL) | O_NONBLOCK);
+        iniciarGerador(&conexao->gerador, semente, (uint64_t)i);
+        struct epoll_event evento = {.events = EPOLLIN, .data.ptr = conexao};
+        if (epoll_ctl(epoll, EPOLL_CTL_ADD, conexao->fd, &evento) != 0) {
+            perror("Erro ao registrar a conexão");
+            status = EXIT_FAILURE;
+        }
+    }
+
+    double inicio = tempoAtualSegundos();
+    for (int i = 0; status == EXIT_SUCCESS && i < num_conexoes; i++) {
+        if (enviarRequisicao(&conexoes[i]) != 0) {
+            perror("Erro ao enviar requisição");
+            status = EXIT_FAILURE;
+        }
+    }
+    int concluidas = 0;
+    struct epoll_event eventos[SERVIDOR_EVENTOS];
+    while (status == EXIT_SUCCESS && concluidas < num_conexoes) {
+        int prontos = epoll_wait(epoll, eventos, SERVIDOR_EVENTOS, CARGA_PRAZO_MS);
+        if (prontos < 0 && errno == EINTR) continue;
+        if (prontos <= 0) {
+            if (prontos == 0) {
+                fprintf(stderr, "O servidor não respondeu em %d ms.\n", CARGA_PRAZO_MS);
+            } else {
+                perror("Erro no epoll_wait");
+            }
+            status = EXIT_FAILURE;
+            break;
+        }
+        for (int i = 0; i < prontos && status == EXIT_SUCCESS; i++) {
+            struct ConexaoCarga* conexao = (struct ConexaoCarga*)eventos[i].data.ptr;
+            int situacao = receberRespostas(conexao, requisicoes, &resultado);
+            if (situacao < 0) {
+                fprintf(stderr, "Conexão %ld falhou na requisição %ld (fechada pelo servidor ou resposta inválida).\n",
+                        (long)(conexao - conexoes), conexao->enviadas);
+                status = EXIT_FAILURE;
+            } else if (situacao > 0) {
+                epoll_ctl(epoll, EPOLL_CTL_DEL, conexao->fd, NULL);
+                concluidas++;
+            }
+        }
+    }
+    double decorrido = tempoAtualSegundos() - inicio;
+
+    for (int i = 0; i < abertas; i++) close(conexoes[i].fd);
+    if (epoll >= 0) close(epoll);
+    free(conexoes);
+
+    if (status == EXIT_SUCCESS) {
+        printf("Carga em '%s': %d conexões x %ld requisições\n", endereco, num_conexoes, requisicoes);
+        printf("%ld respostas em %.3f s (%.0f req/s), %lld com ERRO\n", resultado.respostas, decorrido,
+               decorrido > 0 ? (double)resultado.respostas / decorrido : 0.0, resultado.erros);
+        exibirLatencias("OK", resultado.latencias, resultado.respostas - resultado.erros);
+        exibirLatencias("ERRO", resultado.latencias + resultado.capacidade - resultado.erros, resultado.erros);
+    }
+    free(resultado.latencias);
+    return status;
+}
+
+// --- Modo de Simulação (sem prompts) ---
+
+/**
+ * @brief Retorna o tempo de um relógio monotônico, em segundos.
+ */
+double tempoAtualSegundos() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Executa uma batalha completa com as regras de atacar(), sem saída na tela.
+ * O atacante repete o ataque até conquistar o defensor ou ficar com menos de
+ * 2 tropas (mesma exigência de iniciarAtaque()).
+ * @return 1 se o atacante conquistou o território, 0 caso contrário.
+ */
+int simularBatalha(int tropas_atacante, int tropas_defensor, LoteDados* lote) {
+    return batalhaRelampago(&tropas_atacante, &tropas_defensor, lote);
+}
+
+/**
+ * @brief Número de núcleos disponíveis (padrão de --threads).
+ */
+int numeroDeNucleos() {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) return 1;
+    return (n > MAX_THREADS) ? MAX_THREADS : (int)n;
+}
+
+struct Trabalhadora {
+    MotorParalelo* motor;
+    void* acumulador;
+};
+
+/**
+ * @brief Corpo de cada thread: pega o próximo bloco livre até acabarem.
+ */
+static void* executarTrabalhadora(void* arg) {
+    struct Trabalhadora* t = (struct Trabalhadora*)arg;
+    MotorParalelo* motor = t->motor;
+    GeradorAleatorio gerador;
+
+    long bloco;
+    while ((bloco = atomic_fetch_add_explicit(&motor->proximo_bloco, 1, memory_order_relaxed)) < motor->total_blocos) {
+        // O fluxo do gerador é o número do bloco, não o da thread: mesma semente, mesmo resultado.
+        iniciarGerador(&gerador, motor->semente, (uint64_t)bloco);
+        motor->executar(bloco, &gerador, t->acumulador, motor->contexto);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Distribui total_blocos entre num_threads threads e mescla os acumuladores.
+ * Cada thread tem seu próprio acumulador (zerado e separado por linha de cache),
+ * então não há contenção em contadores compartilhados.
+ * Se pthread_create() falhar, segue com as threads já criadas (no mínimo a
+ * principal): o resultado é o mesmo, só mais lento.
+ * @param resultado Recebe a soma de todos os acumuladores (deve vir zerado).
+ * @return Número de threads que de fato trabalharam, ou -1 se faltar memória.
+ */
+int executarEmParalelo(long total_blocos, int num_threads, uint64_t semente, FuncaoBloco executar, FuncaoMesclar mesclar,
+                       const void* contexto, void* resultado, size_t tamanho_acumulador) {
+    if (num_threads < 1) num_threads = 1;
+    if (num_threads > MAX_THREADS) num_threads = MAX_THREADS;
+    if (num_threads > total_blocos) num_threads = (total_blocos > 0) ? (int)total_blocos : 1;
+
+    MotorParalelo motor;
+    motor.total_blocos = total_blocos;
+    atomic_init(&motor.proximo_bloco, 0);
+    motor.semente = semente;
+    motor.executar = executar;
+    motor.contexto = contexto;
+    motor.passo_acumulador = (tamanho_acumulador + LINHA_CACHE - 1) / LINHA_CACHE * LINHA_CACHE;
+    motor.acumuladores = (unsigned char*)alocarAlinhado(LINHA_CACHE, motor.passo_acumulador * num_threads);
+    if (motor.acumuladores == NULL) {
+        return -1;
+    }
+    memset(motor.acumuladores, 0, motor.passo_acumulador * num_threads);
+
+    pthread_t threads[MAX_THREADS];
+    struct Trabalhadora trabalhadoras[MAX_THREADS];
+    int criadas = 0;
+    for (int i = 0; i < num_threads; i++) {
+        trabalhadoras[i].motor = &motor;
+        trabalhadoras[i].acumulador = motor.acumuladores + motor.passo_acumulador * i;
+        // A thread principal trabalha como a trabalhadora 0.
+        if (i > 0) {
+            if (pthread_create(&threads[i], NULL, executarTrabalhadora, &trabalhadoras[i]) != 0) {
+                break;
+            }
+        }
+        criadas++;
+    }
+    executarTrabalhadora(&trabalhadoras[0]);
+    for (int i = 1; i < criadas; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (int i = 0; i < criadas; i++) {
+        mesclar(resultado, trabalhadoras[i].acumulador, contexto);
+    }
+    free(motor.acumuladores);
+    return criadas;
+}
+
+// Parâmetros do modo --simular, compartilhados (somente leitura) pelas threads.
+struct GradeBatalhas {
+    int max_ataque;
+    int max_defesa;
+    long batalhas_por_celula;
+    long blocos_por_celula;
+};
+
+static void executarBlocoBatalhas(long bloco, GeradorAleatorio* gerador, void* acumulador, const void* contexto) {
+    const struct GradeBatalhas* grade = (const struct GradeBatalhas*)contexto;
+    long long* vitorias = (long long*)acumulador;
+
+    long celula = bloco / grade->blocos_por_celula;
+    long inicio = (bloco % grade->blocos_por_celula) * BLOCO_BATALHAS;
+    long quantidade = grade->batalhas_por_celula - inicio;
+    if (quantidade > BLOCO_BATALHAS) quantidade = BLOCO_BATALHAS;
+
+    int a = 2 + (int)(celula / grade->max_defesa);
+    int d = 1 + (int)(celula % grade->max_defesa);
+
+    LoteDados lote;
+    iniciarLoteDados(&lote, gerador);
+    long long v = 0;
+    for (long b = 0; b < quantidade; b++) {
+        v += simularBatalha(a, d, &lote);
+    }
+    vitorias[celula] += v;
+}
+
+static void mesclarBatalhas(void* destino, const void* origem, const void* contexto) {
+    const struct GradeBatalhas* grade = (const struct GradeBatalhas*)contexto;
+    long celulas = (long)(grade->max_ataque - 1) * grade->max_defesa;
+    for (long c = 0; c < celulas; c++) {
+        ((long long*)destino)[c] += ((const long long*)origem)[c];
+    }
+}
+
+/**
+ * @brief Roda batalhas_por_celula batalhas para cada par (atacante, defensor),
+ * dividindo o trabalho entre num_threads, e imprime uma tabela compacta com a
+ * probabilidade de vitória do atacante.
+ * @return EXIT_SUCCESS ou EXIT_FAILURE (parâmetros inválidos).
+ */
+int executarSimulacao(int max_ataque, int max_defesa, long batalhas_por_celula, uint64_t semente, int num_threads) {
+    if (max_ataque < 2 || max_defesa < 1 || batalhas_por_celula < 1) {
+        fprintf(stderr, "Parâmetros inválidos: atacante >= 2, defensor >= 1, batalhas >= 1.\n");
+        return EXIT_FAILURE;
+    }
+
+    struct GradeBatalhas grade;
+    grade.max_ataque = max_ataque;
+    grade.max_defesa = max_defesa;
+    grade.batalhas_por_celula = batalhas_por_celula;
+    grade.blocos_por_celula = (batalhas_por_celula + BLOCO_BATALHAS - 1) / BLOCO_BATALHAS;
+
+    long celulas = (long)(max_ataque - 1) * max_defesa;
+    long long* vitorias = (long long*)alocarZerado(celulas, sizeof(long long));
+    if (vitorias == NULL) {
+        perror("Erro na alocação da tabela de simulação");
+        return EXIT_FAILURE;
+    }
+
+    double inicio = tempoAtualSegundos();
+    num_threads = executarEmParalelo(celulas * grade.blocos_por_celula, num_threads, semente, executarBlocoBatalhas,
+                                     mesclarBatalhas, &grade, vitorias, celulas * sizeof(long long));
+    if (num_threads < 0) {
+        perror("Erro ao iniciar o motor de simulação");
+        free(vitorias);
+        return EXIT_FAILURE;
+    }
+    double decorrido = tempoAtualSegundos() - inicio;
+    long total_batalhas = celulas * batalhas_por_celula;
+
+    printf("P(vitória do atacante) - %ld batalhas por célula (semente %llu, %d threads)\n",
+           batalhas_por_celula, (unsigned long long)semente, num_threads);
+    printf("Atq\\Def");
+    for (int d = 1; d <= max_defesa; d++) {
+        printf(" %6d", d);
+    }
+    printf("\n");
+
+    for (int a = 2; a <= max_ataque; a++) {
+        printf("%7d", a);
+        for (int d = 1; d <= max_defesa; d++) {
+            long c = (long)(a - 2) * max_defesa + (d - 1);
+            printf(" %6.4f", (double)vitorias[c] / (double)batalhas_por_celula);
+        }
+        printf("\n");
+    }
+
+    printf("%ld batalhas em %.3f s (%.0f batalhas/s)\n", total_batalhas, decorrido,
+           decorrido > 0 ? (double)total_batalhas / decorrido : 0.0);
+    free(vitorias);
+    return EXIT_SUCCESS;
+}
+
+// Nomes das cores usadas nas partidas simuladas.
+static const char* CORES_SIMULACAO[] = {"Azul", "Vermelho", "Verde", "Amarelo", "Preto", "Branco", "Roxo", "Laranja"};
+
+/**
+ * @brief Joga uma partida inteira sem prompts: a cada rodada, cada cor recebe
+ * reforços e faz até 3 ataques aleatórios, cada um uma batalha completa
+ * (batalhaRelampago) até conquistar ou ficar sem tropas.
+ * A partida termina quando uma cor domina todos os territórios ou em SIM_MAX_RODADAS.
+ * @return Índice da cor vencedora ou -1 se não houve vencedor.
+ */
+int simularPartida(Mapa* mapa, int num_territorios, int num_cores, LoteDados* lote, ResultadoPartidas* resultado) {
+    GeradorAleatorio* gerador = lote->gerador;
+    const int* posse = mapa->territorios_por_cor;
+
+    // Reaproveita os vetores do mapa: internadas nesta ordem, as cores têm id == índice.
+    limparMapa(mapa);
+    for (int c = 0; c < num_cores; c++) {
+        internarCor(mapa, CORES_SIMULACAO[c]);
+    }
+    for (int i = 0; i < num_territorios; i++) {
+        int cor = i % num_cores;
+        char nome[NOME_MAX];
+        snprintf(nome, NOME_MAX, "T%d", i);
+        adicionarTerritorio(mapa, nome, CORES_SIMULACAO[cor], 1 + (int)sortearLimitado(gerador, 5));
+    }
+
+    const uint8_t* dono = mapa->dono;
+    const int* tropas = mapa->tropas;
+
+    for (int rodada = 1; rodada <= SIM_MAX_RODADAS; rodada++) {
+        for (int cor = 0; cor < num_cores; cor++) {
+            if (posse[cor] == 0) continue;
+
+            // Reforço: max(3, territórios/3) tropas em um território próprio sorteado
+            int reforco = posse[cor] / 3 > 3 ? posse[cor] / 3 : 3;
+            int alvo = territoriosDaCor(mapa, cor)[sortearLimitado(gerador, (uint32_t)posse[cor])];
+            alterarTropas(mapa, alvo, reforco);
+
+            for (int tentativa = 0; tentativa < 3; tentativa++) {
+                int atacante = (int)sortearLimitado(gerador, (uint32_t)num_territorios);
+                int defensor = (int)sortearLimitado(gerador, (uint32_t)num_territorios);
+                if (dono[atacante] != cor || dono[defensor] == cor || tropas[atacante] < 2) {
+                    continue;
+                }
+
+                resultado->ataques++;
+                if (aplicarBatalha(mapa, atacante, defensor, lote)) {
+                    if (posse[cor] == num_territorios) {
+                        resultado->rodadas += rodada;
+                        return cor;
+                    }
+                }
+            }
+        }
+    }
+    resultado->rodadas += SIM_MAX_RODADAS;
+    return -1;
+}
+
+struct ConfigPartidas {
+    long partidas;
+    int num_territorios;
+    int num_cores;
+};
+
+static void executarBlocoPartidas(long bloco, GeradorAleatorio* gerador, void* acumulador, const void* contexto) {
+    const struct ConfigPartidas* config = (const struct ConfigPartidas*)contexto;
+    ResultadoPartidas* resultado = (ResultadoPartidas*)acumulador;
+
+    long inicio = bloco * BLOCO_PARTIDAS;
+    long quantidade = config->partidas - inicio;
+    if (quantidade > BLOCO_PARTIDAS) quantidade = BLOCO_PARTIDAS;
+
+    Arena arena;
+    iniciarArena(&arena);
+    Mapa* mapa = criarMapa(&arena, config->num_territorios);
+    if (mapa == NULL) {
+        arenaLiberar(&arena);
+        resultado->sem_vencedor += quantidade;
+        return;
+    }
+
+    LoteDados lote;
+    iniciarLoteDados(&lote, gerador);
+    for (long p = 0; p < quantidade; p++) {
+        int vencedor = simularPartida(mapa, config->num_territorios, config->num_cores, &lote, resultado);
+        if (vencedor >= 0) {
+            resultado->vitorias[vencedor]++;
+        } else {
+            resultado->sem_vencedor++;
+        }
+    }
+    arenaLiberar(&arena);
+}
+
+static void mesclarPartidas(void* destino, const void* origem, const void* contexto) {
+    (void)contexto;
+    ResultadoPartidas* d = (ResultadoPartidas*)destino;
+    const ResultadoPartidas* o = (const ResultadoPartidas*)origem;
+    for (int c = 0; c < SIM_MAX_CORES; c++) {
+        d->vitorias[c] += o->vitorias[c];
+    }
+    d->sem_vencedor += o->sem_vencedor;
+    d->rodadas += o->rodadas;
+    d->ataques += o->ataques;
+}
+
+/**
+ * @brief Roda 'partidas' partidas completas em paralelo e imprime a taxa de
+ * vitória de cada cor e a vazão em partidas/s.
+ * @return EXIT_SUCCESS ou EXIT_FAILURE (parâmetros inválidos).
+ */
+int executarSimulacaoPartidas(long partidas, int num_territorios, int num_cores, uint64_t semente, int num_threads) {
+    if (partidas < 1 || num_cores < 2 || num_cores > SIM_MAX_CORES || num_territorios < num_cores) {
+        fprintf(stderr, "Parâmetros inválidos: partidas >= 1, 2 <= cores <= %d, territórios >= cores.\n",
+                SIM_MAX_CORES);
+        return EXIT_FAILURE;
+    }
+
+    struct ConfigPartidas config = {partidas, num_territorios, num_cores};
+    ResultadoPartidas resultado;
+    memset(&resultado, 0, sizeof(resultado));
+
+    double inicio = tempoAtualSegundos();
+    num_threads = executarEmParalelo((partidas + BLOCO_PARTIDAS - 1) / BLOCO_PARTIDAS, num_threads, semente,
+                                     executarBlocoPartidas, mesclarPartidas, &config, &resultado, sizeof(resultado));
+    if (num_threads < 0) {
+        perror("Erro ao iniciar o motor de simulação");
+        return EXIT_FAILURE;
+    }
+    double decorrido = tempoAtualSegundos() - inicio;
+
+    printf("%ld partidas, %d territórios, %d cores (semente %llu, %d threads)\n", partidas, num_territorios, num_cores,
+           (unsigned long long)semente, num_threads);
+    for (int c = 0; c < num_cores; c++) {
+        printf("%-9s %6.4f\n", CORES_SIMULACAO[c], (double)resultado.vitorias[c] / (double)partidas);
+    }
+    printf("Sem vencedor %6.4f\n", (double)resultado.sem_vencedor / (double)partidas);
+    printf("Média de rodadas: %.1f, ataques: %lld\n", (double)resultado.rodadas / (double)partidas, resultado.ataques);
+    printf("%ld partidas em %.3f s (%.0f partidas/s)\n", partidas, decorrido,
+           decorrido > 0 ? (double)partidas / decorrido : 0.0);
+    return EXIT_SUCCESS;
+}
+
+// --- Probabilidades Exatas (programação dinâmica) ---
+
+// Distribuição de uma rodada para cada combinação de dados: probabilidade de o
+// atacante perder k tropas com n_a dados de ataque e n_d de defesa (o defensor
+// perde min(n_a, n_d) - k).
+struct DistribuicaoRodadas {
+    double perda_atacante[DADOS_ATAQUE_MAX][DADOS_DEFESA_MAX][DADOS_DEFESA_MAX + 1];
+};
+
+/**
+ * @brief Enumera as 6^(n_a + n_d) rolagens de cada combinação de dados e as passa
+ * por compararDados() (as mesmas regras de atacar()). São no máximo 7776 por
+ * combinação, então é feito uma vez por crescimento da tabela.
+ */
+static void calcularDistribuicaoRodadas(struct DistribuicaoRodadas* distribuicao) {
+    memset(distribuicao, 0, sizeof(*distribuicao));
+    for (int na = 1; na <= DADOS_ATAQUE_MAX; na++) {
+        for (int nd = 1; nd <= DADOS_DEFESA_MAX; nd++) {
+            int combinacoes = 1;
+            for (int i = 0; i < na + nd; i++) combinacoes *= 6;
+            for (int c = 0; c < combinacoes; c++) {
+                RodadaCombate rodada = {na, nd, {0}, {0}, 0, 0};
+                int resto = c;
+                for (int i = 0; i < na; i++, resto /= 6) rodada.dados_ataque[i] = resto % 6 + 1;
+                for (int i = 0; i < nd; i++, resto /= 6) rodada.dados_defesa[i] = resto % 6 + 1;
+                compararDados(&rodada);
+                distribuicao->perda_atacante[na - 1][nd - 1][rodada.perdas_atacante] += 1.0 / combinacoes;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Calcula a célula (a, d) a partir das células com menos tropas, que já
+ * precisam estar prontas (toda rodada tira pelo menos uma tropa de algum lado).
+ */
+static void calcularCelulaBatalha(TabelaBatalhas* tabela, int a, int d, const struct DistribuicaoRodadas* distribuicao) {
+    int largura = tabela->max_defesa + 1;
+    ResultadoBatalha* r = &tabela->celulas[(long)a * largura + d];
+    r->vitoria = (d == 0) ? 1.0 : 0.0;
+    r->perdas_atacante = 0.0;
+    r->perdas_defensor = 0.0;
+    // Mesmo critério de parada de iniciarAtaque(): atacar exige 2 tropas.
+    if (d == 0 || a < 2) {
+        return;
+    }
+
+    int na = dadosDeAtaque(a);
+    int nd = dadosDeDefesa(d);
+    int pares = na < nd ? na : nd;
+    const double* probabilidade = distribuicao->perda_atacante[na - 1][nd - 1];
+    for (int perda_atacante = 0; perda_atacante <= pares; perda_atacante++) {
+        double p = probabilidade[perda_atacante];
+        if (p == 0.0) continue;
+        int perda_defensor = pares - perda_atacante;
+        // Na conquista (d chega a 0) as tropas movidas continuam sendo do atacante: não são perdas.
+        const ResultadoBatalha* proximo = &tabela->celulas[(long)(a - perda_atacante) * largura + (d - perda_defensor)];
+        r->vitoria += p * proximo->vitoria;
+        r->perdas_atacante += p * (perda_atacante + proximo->perdas_atacante);
+        r->perdas_defensor += p * (perda_defensor + proximo->perdas_defensor);
+    }
+}
+
+/**
+ * @brief Prepara uma tabela vazia; as células são calculadas na primeira consulta.
+ */
+void iniciarTabelaBatalhas(TabelaBatalhas* tabela) {
+    tabela->max_ataque = -1;
+    tabela->max_defesa = -1;
+    tabela->celulas = NULL;
+}
+
+/**
+ * @brief Garante que a tabela cubra 0..max_ataque x 0..max_defesa. As células já
+ * calculadas são copiadas; só as novas passam pela recorrência.
+ * @return 0 em caso de sucesso, -1 se passar de PROB_MAX_TROPAS ou faltar memória.
+ */
+int garantirTabelaBatalhas(TabelaBatalhas* tabela, int max_ataque, int max_defesa) {
+    if (max_ataque <= tabela->max_ataque && max_defesa <= tabela->max_defesa) {
+        return 0;
+    }
+    if (max_ataque > PROB_MAX_TROPAS || max_defesa > PROB_MAX_TROPAS) {
+        return -1;
+    }
+
+    // Cresce em dobro para que consultas crescentes não recalculem a tabela toda vez.
+    int novo_ataque = (tabela->max_ataque < PROB_TABELA_INICIAL) ? PROB_TABELA_INICIAL : tabela->max_ataque * 2;
+    int nova_defesa = (tabela->max_defesa < PROB_TABELA_INICIAL) ? PROB_TABELA_INICIAL : tabela->max_defesa * 2;
+    if (novo_ataque < max_ataque) novo_ataque = max_ataque;
+    if (nova_defesa < max_defesa) nova_defesa = max_defesa;
+    if (novo_ataque > PROB_MAX_TROPAS) novo_ataque = PROB_MAX_TROPAS;
+    if (nova_defesa > PROB_MAX_TROPAS) nova_defesa = PROB_MAX_TROPAS;
+    if (novo_ataque < tabela->max_ataque) novo_ataque = tabela->max_ataque;
+    if (nova_defesa < tabela->max_defesa) nova_defesa = tabela->max_defesa;
+
+    ResultadoBatalha* celulas = (ResultadoBatalha*)alocar((size_t)(novo_ataque + 1) * (nova_defesa + 1) * sizeof(ResultadoBatalha));
+    if (celulas == NULL) {
+        return -1;
+    }
+
+    TabelaBatalhas nova = {novo_ataque, nova_defesa, celulas};
+    struct DistribuicaoRodadas distribuicao;
+    calcularDistribuicaoRodadas(&distribuicao);
+    // Ordem crescente de (a, d): as dependências de cada célula já estão prontas.
+    for (int a = 0; a <= novo_ataque; a++) {
+        for (int d = 0; d <= nova_defesa; d++) {
+            if (a <= tabela->max_ataque && d <= tabela->max_defesa) {
+                celulas[(long)a * (nova_defesa + 1) + d] = tabela->celulas[(long)a * (tabela->max_defesa + 1) + d];
+            } else {
+                calcularCelulaBatalha(&nova, a, d, &distribuicao);
+            }
+        }
+    }
+
+    free(tabela->celulas);
+    *tabela = nova;
+    return 0;
+}
+
+/**
+ * @brief Consulta O(1) do resultado exato de uma batalha (a tabela é estendida se preciso).
+ * @return Ponteiro para a célula, ou NULL se as tropas passarem de PROB_MAX_TROPAS.
+ */
+const ResultadoBatalha* consultarBatalha(TabelaBatalhas* tabela, int tropas_atacante, int tropas_defensor) {
+    if (tropas_atacante < 0 || tropas_defensor < 0 ||
+        garantirTabelaBatalhas(tabela, tropas_atacante, tropas_defensor) != 0) {
+        return NULL;
+    }
+    return &tabela->celulas[(long)tropas_atacante * (tabela->max_defesa + 1) + tropas_defensor];
+}
+
+/**
+ * @brief Libera as células da tabela.
+ */
+void liberarTabelaBatalhas(TabelaBatalhas* tabela) {
+    free(tabela->celulas);
+    iniciarTabelaBatalhas(tabela);
+}
+
+/**
+ * @brief Imprime as probabilidades exatas de vitória e as perdas esperadas do
+ * atacante para cada par (atacante, defensor), no mesmo formato de --simular.
+ * @return EXIT_SUCCESS ou EXIT_FAILURE (parâmetros inválidos).
+ */
+int executarProbabilidades(int max_ataque, int max_defesa) {
+    if (max_ataque < 2 || max_defesa < 1 || max_ataque > PROB_MAX_TROPAS || max_defesa > PROB_MAX_TROPAS) {
+        fprintf(stderr, "Parâmetros inválidos: 2 <= atacante <= %d, 1 <= defensor <= %d.\n", PROB_MAX_TROPAS, PROB_MAX_TROPAS);
+        return EXIT_FAILURE;
+    }
+
+    TabelaBatalhas tabela;
+    iniciarTabelaBatalhas(&tabela);
+    double inicio = tempoAtualSegundos();
+    if (garantirTabelaBatalhas(&tabela, max_ataque, max_defesa) != 0) {
+        perror("Erro na alocação da tabela de probabilidades");
+        return EXIT_FAILURE;
+    }
+    double decorrido = tempoAtualSegundos() - inicio;
+
+    printf("P(vitória do atacante) - exata\n");
+    printf("Atq\\Def");
+    for (int d = 1; d <= max_defesa; d++) {
+        printf(" %6d", d);
+    }
+    printf("\n");
+    for (int a = 2; a <= max_ataque; a++) {
+        printf("%7d", a);
+        for (int d = 1; d <= max_defesa; d++) {
+            printf(" %6.4f", consultarBatalha(&tabela, a, d)->vitoria);
+        }
+        printf("\n");
+    }
+
+    printf("\nPerdas esperadas do atacante\n");
+    printf("Atq\\Def");
+    for (int d = 1; d <= max_defesa; d++) {
+        printf(" %6d", d);
+    }
+    printf("\n");
+    for (int a = 2; a <= max_ataque; a++) {
+        printf("%7d", a);
+        for (int d = 1; d <= max_defesa; d++) {
+            printf(" %6.3f", consultarBatalha(&tabela, a, d)->perdas_atacante);
+        }
+        printf("\n");
+    }
+
+    // Custo de uma consulta já memorizada, para comparar com simular a batalha.
+    long consultas = 0;
+    double soma = 0.0;
+    double inicio_consultas = tempoAtualSegundos();
+    long celulas = (long)(max_ataque - 1) * max_defesa;
+    long repeticoes = (celulas < 10000000) ? 10000000 / celulas : 1;
+    for (long repeticao = 0; repeticao < repeticoes; repeticao++) {
+        for (int a = 2; a <= max_ataque; a++) {
+            for (int d = 1; d <= max_defesa; d++) {
+                soma += consultarBatalha(&tabela, a, d)->vitoria;
+                consultas++;
+            }
+        }
+    }
+    double decorrido_consultas = tempoAtualSegundos() - inicio_consultas;
+
+    printf("Tabela %dx%d calculada em %.3f ms; %ld consultas a %.1f ns cada (soma %.1f)\n",
+           tabela.max_ataque, tabela.max_defesa, decorrido * 1000.0, consultas,
+           consultas > 0 ? decorrido_consultas * 1e9 / consultas : 0.0, soma);
+    liberarTabelaBatalhas(&tabela);
+    return EXIT_SUCCESS;
+}
+
+// --- Jogadores Automáticos (IA) ---
+
+static const char* NOMES_POLITICAS[] = {"aleatoria", "gulosa", "mcts"};
+
+/**
+ * @brief Cria na arena uma cópia leve do mapa para rollouts. Dono, tropas, cores,
+ * agregados e ordem_por_cor são copiados. Nomes, fronteiras e grafo continuam sendo
+ * os da origem: com capacidade == total, qualquer cadastro na cópia realoca antes
+ * de escrever. O índice de nomes fica de fora (a cópia monta o seu se precisar).
+ * @return Ponteiro para a cópia ou NULL se faltar memória.
+ */
+Mapa* clonarMapa(Arena* arena, const Mapa* origem) {
+    Mapa* copia = (Mapa*)arenaAlocar(arena, sizeof(Mapa));
+    if (copia == NULL) return NULL;
+
+    *copia = *origem;
+    copia->arena = arena;
+    copia->mapeamento = NULL;
+    copia->tamanho_mapeamento = 0;
+    copia->capacidade = origem->total;
+    copia->capacidade_fronteiras = origem->total_fronteiras;
+    copia->capacidade_grafo_inicio = 0; // o grafo é o da origem: reconstruir aloca outro
+    copia->capacidade_grafo_vizinhos = 0;
+    copia->desfazer = NULL;
+    copia->total_desfazer = 0;
+    copia->capacidade_desfazer = 0;
+    copia->registrando = 0;
+    copia->desfazer_incompleto = 0;
+    copia->indice_nomes = NULL;
+    copia->capacidade_indice = 0;
+    copia->nomes_indexados = 0;
+    copia->rascunho = NULL;
+    size_t n = (size_t)(origem->total > 0 ? origem->total : 1);
+    copia->dono = (uint8_t*)arenaAlocar(arena, n * sizeof(uint8_t));
+    copia->tropas = (int*)arenaAlocar(arena, n * sizeof(int));
+    copia->ordem_por_cor = (int*)arenaAlocar(arena, n * sizeof(int));
+    copia->posicao_na_ordem = (int*)arenaAlocar(arena, n * sizeof(int));
+    if (copia->dono == NULL || copia->tropas == NULL || copia->ordem_por_cor == NULL || copia->posicao_na_ordem == NULL ||
+        prepararRascunho(copia, origem->total) != 0) {
+        return NULL;
+    }
+
+    copiarEstadoMapa(copia, origem);
+    return copia;
+}
+
+/**
+ * @brief Volta uma cópia de clonarMapa() ao estado da origem (mesmos territórios),
+ * copiando os vetores inteiros. Nos rollouts, desfazerAte() faz o mesmo em O(alterações).
+ */
+void copiarEstadoMapa(Mapa* destino, const Mapa* origem) {
+    int cores = origem->cores.total;
+    memcpy(destino->dono, origem->dono, (size_t)origem->total * sizeof(uint8_t));
+    memcpy(destino->tropas, origem->tropas, (size_t)origem->total * sizeof(int));
+    memcpy(destino->ordem_por_cor, origem->ordem_por_cor, (size_t)origem->total * sizeof(int));
+    memcpy(destino->posicao_na_ordem, origem->posicao_na_ordem, (size_t)origem->total * sizeof(int));
+    memcpy(destino->inicio_cor, origem->inicio_cor, (size_t)cores * sizeof(int));
+    memcpy(destino->territorios_por_cor, origem->territorios_por_cor, (size_t)cores * sizeof(int));
+    memcpy(destino->tropas_por_cor, origem->tropas_por_cor, (size_t)cores * sizeof(long long));
+    destino->tropas_total = origem->tropas_total;
+}
+
+/**
+ * @brief Chance exata de conquista numa batalha completa, com as tropas saturadas
+ * no tamanho da tabela. Não estende a tabela: pode ser lida por várias threads.
+ */
+static double chanceConquista(const TabelaBatalhas* tabela, int tropas_atacante, int tropas_defensor) {
+    if (tropas_atacante > tabela->max_ataque) tropas_atacante = tabela->max_ataque;
+    if (tropas_defensor > tabela->max_defesa) tropas_defensor = tabela->max_defesa;
+    return tabela->celulas[(long)tropas_atacante * (tabela->max_defesa + 1) + tropas_defensor].vitoria;
+}
+
+/**
+ * @brief Guarda a jogada na lista; cheia, ela substitui a de menor chance.
+ */
+static void considerarJogada(Jogada* jogadas, double* chances, int* total, int max, int a, int d, double chance) {
+    int posicao = *total;
+    if (posicao == max) {
+        posicao = 0;
+        for (int i = 1; i < max; i++) {
+            if (chances[i] < chances[posicao]) posicao = i;
+        }
+        if (chance <= chances[posicao]) return;
+    } else {
+        (*total)++;
+    }
+    jogadas[posicao].atacante = a;
+    jogadas[posicao].defensor = d;
+    chances[posicao] = chance;
+}
+
+/**
+ * @brief Lista os ataques possíveis da cor: origem própria com 2+ tropas e alvo
+ * inimigo vizinho. Passando de 'max' (até IA_MAX_CANDIDATOS), ficam os de maior
+ * chance de conquista. Requer atualizarGrafo().
+ * @return Quantidade de jogadas escritas em 'jogadas'.
+ */
+int listarJogadas(const Mapa* mapa, int cor, const TabelaBatalhas* tabela, Jogada* jogadas, int max) {
+    double chances[IA_MAX_CANDIDATOS];
+    int total = 0;
+    if (max > IA_MAX_CANDIDATOS) max = IA_MAX_CANDIDATOS;
+
+    const int* da_cor = territoriosDaCor(mapa, cor);
+    for (int k_origem = 0; k_origem < mapa->territorios_por_cor[cor]; k_origem++) {
+        int a = da_cor[k_origem];
+        if (mapa->tropas[a] < 2) continue;
+
+        if (mapa->total_fronteiras == 0) {
+            for (int d = 0; d < mapa->total; d++) {
+                if (mapa->dono[d] != cor) {
+                    considerarJogada(jogadas, chances, &total, max, a, d, chanceConquista(tabela, mapa->tropas[a], mapa->tropas[d]));
+                }
+            }
+        } else if (a < mapa->grafo_territorios) {
+            for (int k = mapa->grafo_inicio[a]; k < mapa->grafo_inicio[a + 1]; k++) {
+                int d = mapa->grafo_vizinhos[k];
+                if (mapa->dono[d] != cor) {
+                    considerarJogada(jogadas, chances, &total, max, a, d, chanceConquista(tabela, mapa->tropas[a], mapa->tropas[d]));
+                }
+            }
+        }
+    }
+    return total;
+}
+
+/**
+ * @brief Indica se o território faz fronteira com alguma outra cor.
+ */
+static int temVizinhoInimigo(const Mapa* mapa, int id) {
+    if (mapa->total_fronteiras == 0) {
+        return mapa->territorios_por_cor[mapa->dono[id]] < mapa->total;
+    }
+    if (id >= mapa->grafo_territorios) return 0;
+    for (int k = mapa->grafo_inicio[id]; k < mapa->grafo_inicio[id + 1]; k++) {
+        if (mapa->dono[mapa->grafo_vizinhos[k]] != mapa->dono[id]) return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Reforço do início do turno: max(3, territórios/3) tropas em um só território.
+ * A política aleatória sorteia o território; as outras reforçam a fronteira mais forte.
+ */
+void reforcarCor(Mapa* mapa, int cor, TipoPolitica politica, GeradorAleatorio* gerador) {
+    int posse = mapa->territorios_por_cor[cor];
+    if (posse == 0) return;
+
+    int reforco = posse / 3 > 3 ? posse / 3 : 3;
+    const int* da_cor = territoriosDaCor(mapa, cor);
+    int alvo = -1;
+    if (politica != POLITICA_ALEATORIA) {
+        for (int k = 0; k < posse; k++) {
+            int i = da_cor[k];
+            // No empate, o menor id: o resultado não depende da ordem do segmento.
+            if ((alvo < 0 || mapa->tropas[i] > mapa->tropas[alvo] || (mapa->tropas[i] == mapa->tropas[alvo] && i < alvo)) &&
+                temVizinhoInimigo(mapa, i)) {
+                alvo = i;
+            }
+        }
+    }
+    if (alvo < 0) {
+        alvo = da_cor[sortearLimitado(gerador, (uint32_t)posse)];
+    }
+    alterarTropas(mapa, alvo, reforco);
+}
+
+/**
+ * @brief Ataques usados nos rollouts do MCTS: a política gulosa, que é barata
+ * (consulta à tabela) e mais realista que ataques sorteados.
+ */
+static void jogarAtaquesGulosos(Mapa* mapa, int cor, const TabelaBatalhas* tabela, int ataques, LoteDados* lote) {
+    JogadorIA guloso;
+    memset(&guloso, 0, sizeof(guloso));
+    guloso.politica = POLITICA_GULOSA;
+    guloso.tabela = tabela;
+
+    Jogada jogada;
+    for (int ataque = 0; ataque < ataques && escolherJogada(&guloso, mapa, cor, ataques - ataque, lote->gerador, &jogada); ataque++) {
+        aplicarBatalha(mapa, jogada.atacante, jogada.defensor, lote);
+    }
+}
+
+// Uma decisão do MCTS, compartilhada (somente leitura) pelos blocos da busca.
+struct BuscaMCTS {
+    const Mapa* base;
+    int cor;
+    const Jogada* jogadas;       // a última é "encerrar o turno" (atacante -1)
+    int total_jogadas;
+    int ataques_restantes;       // ataques que ainda cabem no turno, contando a jogada
+    const TabelaBatalhas* tabela;
+    long rollouts_por_bloco;
+    double prazo;                // instante limite (tempoAtualSegundos); 0 = sem prazo
+};
+
+/**
+ * @brief Aplica a jogada numa cópia do mapa, termina o turno com ataques gulosos,
+ * joga IA_HORIZONTE rodadas gulosas e devolve a fatia do mapa que ficou com a
+ * cor (0..IA_VALOR_MAXIMO). Avaliar "jogada + guloso" garante que a busca só
+ * troca a escolha gulosa quando os rollouts mostram algo melhor.
+ */
+static long long executarRollout(Mapa* copia, const struct BuscaMCTS* busca, const Jogada* jogada, LoteDados* lote) {
+    int cor = busca->cor;
+    const int* posse = copia->territorios_por_cor;
+
+    if (jogada->atacante >= 0) {
+        aplicarBatalha(copia, jogada->atacante, jogada->defensor, lote);
+        jogarAtaquesGulosos(copia, cor, busca->tabela, busca->ataques_restantes - 1, lote);
+    }
+    for (int rodada = 0; rodada < IA_HORIZONTE; rodada++) {
+        // Os adversários jogam primeiro (o turno da cor atual acabou de terminar).
+        for (int passo = 1; passo <= copia->cores.total; passo++) {
+            int vez = (cor + passo) % copia->cores.total;
+            if (posse[cor] == 0 || posse[cor] == copia->total) break;
+            if (posse[vez] > 0) {
+                reforcarCor(copia, vez, POLITICA_GULOSA, lote->gerador);
+                jogarAtaquesGulosos(copia, vez, busca->tabela, IA_MAX_ATAQUES, lote);
+            }
+        }
+    }
+    if (posse[cor] == copia->total) return IA_VALOR_MAXIMO;
+    // Média das fatias de territórios e de tropas: menos ruído que só territórios.
+    return ((long long)posse[cor] * IA_VALOR_MAXIMO / copia->total +
+            copia->tropas_por_cor[cor] * IA_VALOR_MAXIMO / (copia->tropas_total > 0 ? copia->tropas_total : 1)) / 2;
+}
+
+/**
+ * @brief Um bloco da busca: UCB1 sobre as jogadas da raiz, com rollouts numa
+ * cópia própria do mapa. A k-ésima visita de cada jogada usa o mesmo fluxo de
+ * dados (números aleatórios comuns), então as jogadas são comparadas sob a
+ * mesma sorte. Em mapas grandes, cada rollout é desfeito pelo registro de
+ * desfazer (custo proporcional às alterações); nos pequenos, copiar os vetores
+ * de volta sai mais barato que registrar cada alteração. Visitas e valores são somados ao
+ * acumulador só no fim, para que o bloco não dependa do que a thread fez antes.
+ */
+static void executarBlocoMCTS(long bloco, GeradorAleatorio* gerador, void* acumulador, const void* contexto) {
+    (void)bloco;
+    const struct BuscaMCTS* busca = (const struct BuscaMCTS*)contexto;
+    int n = busca->total_jogadas;
+    long long* visitas_total = (long long*)acumulador;
+    long long* valores_total = visitas_total + n;
+
+    Arena arena;
+    iniciarArena(&arena);
+    Mapa* copia = clonarMapa(&arena, busca->base);
+    long long* visitas = (long long*)arenaAlocar(&arena, (size_t)n * 2 * sizeof(long long));
+    if (copia == NULL || visitas == NULL) {
+        arenaLiberar(&arena);
+        return;
+    }
+    long long* valores = visitas + n;
+
+    uint64_t semente_bloco = proximoAleatorio(gerador);
+    int usar_desfazer = busca->base->total >= IA_DESFAZER_MINIMO;
+    if (usar_desfazer) ativarDesfazer(copia);
+    long inicio_rollout = marcarDesfazer(copia);
+    for (long r = 0; r < busca->rollouts_por_bloco; r++) {
+        if (busca->prazo > 0 && r % 16 == 0 && tempoAtualSegundos() >= busca->prazo) break;
+
+        int escolhida = 0;
+        double melhor = -1.0;
+        for (int i = 0; i < n; i++) {
+            if (visitas[i] == 0) {
+                escolhida = i;
+                break;
+            }
+            double ucb = (double)valores[i] / ((double)visitas[i] * IA_VALOR_MAXIMO) +
+                         IA_EXPLORACAO * sqrt(log((double)r) / (double)visitas[i]);
+            if (ucb > melhor) {
+                melhor = ucb;
+                escolhida = i;
+            }
+        }
+
+        GeradorAleatorio gerador_rollout;
+        LoteDados lote;
+        iniciarGerador(&gerador_rollout, semente_bloco, (uint64_t)visitas[escolhida]);
+        iniciarLoteDados(&lote, &gerador_rollout);
+        valores[escolhida] += executarRollout(copia, busca, &busca->jogadas[escolhida], &lote);
+        visitas[escolhida]++;
+        if (!usar_desfazer || desfazerAte(copia, inicio_rollout) != 0) {
+            copiarEstadoMapa(copia, busca->base);
+            if (usar_desfazer) ativarDesfazer(copia);
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        visitas_total[i] += visitas[i];
+        valores_total[i] += valores[i];
+    }
+    arenaLiberar(&arena);
+}
+
+static void mesclarMCTS(void* destino, const void* origem, const void* contexto) {
+    const struct BuscaMCTS* busca = (const struct BuscaMCTS*)contexto;
+    for (int i = 0; i < busca->total_jogadas * 2; i++) {
+        ((long long*)destino)[i] += ((const long long*)origem)[i];
+    }
+}
+
+/**
+ * @brief MCTS de um nível (UCB1 na raiz, rollouts gulosos) paralelizado na
+ * raiz: cada bloco busca sozinho e as visitas são somadas. Com orçamento de
+ * tempo, há um bloco por thread até o prazo; sem ele, IA_BLOCOS_BUSCA blocos
+ * dividem max_rollouts e a escolha é a mesma com qualquer número de threads.
+ * @return 1 se escolheu um ataque, 0 se é melhor encerrar o turno.
+ */
+static int buscarJogadaMCTS(const JogadorIA* jogador, const Mapa* mapa, int cor, int ataques_restantes, GeradorAleatorio* gerador,
+                            Jogada* jogada) {
+    Jogada jogadas[IA_MAX_CANDIDATOS + 1];
+    int n = listarJogadas(mapa, cor, jogador->tabela, jogadas, IA_CANDIDATOS_MCTS);
+    if (n == 0) return 0;
+    jogadas[n].atacante = -1;
+    jogadas[n].defensor = -1;
+    n++;
+
+    struct BuscaMCTS busca;
+    busca.base = mapa;
+    busca.cor = cor;
+    busca.jogadas = jogadas;
+    busca.total_jogadas = n;
+    busca.ataques_restantes = ataques_restantes;
+    busca.tabela = jogador->tabela;
+    long blocos;
+    if (jogador->tempo_jogada > 0) {
+        blocos = jogador->threads;
+        busca.rollouts_por_bloco = LONG_MAX;
+        busca.prazo = tempoAtualSegundos() + jogador->tempo_jogada;
+    } else {
+        blocos = IA_BLOCOS_BUSCA;
+        busca.rollouts_por_bloco = (jogador->max_rollouts + IA_BLOCOS_BUSCA - 1) / IA_BLOCOS_BUSCA;
+        busca.prazo = 0;
+    }
+
+    long long resultado[2 * (IA_MAX_CANDIDATOS + 1)];
+    memset(resultado, 0, sizeof(resultado));
+    // Semente tirada do gerador da partida: a mesma partida repete as mesmas buscas.
+    uint64_t semente = proximoAleatorio(gerador);
+    if (executarEmParalelo(blocos, jogador->threads, semente, executarBlocoMCTS, mesclarMCTS, &busca, resultado,
+                           (size_t)n * 2 * sizeof(long long)) < 0) {
+        return 0;
+    }
+
+    // A mais visitada; no empate (orçamento curto), a de maior valor somado.
+    int melhor = 0;
+    for (int i = 1; i < n; i++) {
+        if (resultado[i] > resultado[melhor] || (resultado[i] == resultado[melhor] && resultado[n + i] > resultado[n + melhor])) {
+            melhor = i;
+        }
+    }
+    *jogada = jogadas[melhor];
+    return jogada->atacante >= 0;
+}
+
+/**
+ * @brief Pede à política do jogador o próximo ataque da cor.
+ * @param ataques_restantes Ataques que ainda cabem no turno (o MCTS simula o resto do turno).
+ * @return 1 se 'jogada' recebeu um ataque, 0 se o jogador encerra o turno.
+ */
+int escolherJogada(const JogadorIA* jogador, const Mapa* mapa, int cor, int ataques_restantes, GeradorAleatorio* gerador, Jogada* jogada) {
+    Jogada jogadas[IA_MAX_CANDIDATOS];
+    int n;
+
+    switch (jogador->politica) {
+        case POLITICA_ALEATORIA:
+            n = listarJogadas(mapa, cor, jogador->tabela, jogadas, IA_MAX_CANDIDATOS);
+            if (n == 0) return 0;
+            *jogada = jogadas[sortearLimitado(gerador, (uint32_t)n)];
+            return 1;
+
+        case POLITICA_GULOSA: {
+            n = listarJogadas(mapa, cor, jogador->tabela, jogadas, IA_MAX_CANDIDATOS);
+            int melhor = -1;
+            double melhor_chance = IA_LIMIAR_GULOSO;
+            for (int i = 0; i < n; i++) {
+                double chance = chanceConquista(jogador->tabela, mapa->tropas[jogadas[i].atacante], mapa->tropas[jogadas[i].defensor]);
+                if (chance > melhor_chance) {
+                    melhor_chance = chance;
+                    melhor = i;
+                }
+            }
+            if (melhor < 0) return 0;
+            *jogada = jogadas[melhor];
+            return 1;
+        }
+
+        case POLITICA_MCTS:
+            return buscarJogadaMCTS(jogador, mapa, cor, ataques_restantes, gerador, jogada);
+    }
+    return 0;
+}
+
+// Configuração do modo --bots, compartilhada (somente leitura) pelas threads.
+struct ConfigBots {
+    long partidas;
+    int num_territorios;
+    int num_cores;
+    JogadorIA jogadores[SIM_MAX_CORES];
+};
+
+/**
+ * @brief Monta o tabuleiro dos bots: territórios numa grade quase quadrada, com
+ * fronteiras entre vizinhos de linha e de coluna.
+ * @return 0 em caso de sucesso, -1 se faltar memória.
+ */
+static int montarGradeBots(Mapa* mapa, int num_territorios, int num_cores) {
+    int largura = 1;
+    while (largura * largura < num_territorios) largura++;
+
+    for (int c = 0; c < num_cores; c++) {
+        internarCor(mapa, CORES_SIMULACAO[c]);
+    }
+    for (int i = 0; i < num_territorios; i++) {
+        char nome[NOME_MAX];
+        snprintf(nome, NOME_MAX, "T%d", i);
+        if (adicionarTerritorio(mapa, nome, CORES_SIMULACAO[i % num_cores], 1) < 0) return -1;
+    }
+    for (int i = 0; i < num_territorios; i++) {
+        if (i % largura + 1 < largura && i + 1 < num_territorios && adicionarFronteira(mapa, i, i + 1) != 0) return -1;
+        if (i + largura < num_territorios && adicionarFronteira(mapa, i, i + largura) != 0) return -1;
+    }
+    return atualizarGrafo(mapa);
+}
+
+/**
+ * @brief Redistribui a grade para uma nova partida: cada cor recebe a mesma
+ * quantidade de territórios (±1) em posições embaralhadas, com 1 a 5 tropas.
+ */
+static void distribuirTerritorios(Mapa* mapa, int num_cores, GeradorAleatorio* gerador) {
+    int n = mapa->total;
+    for (int i = 0; i < n; i++) {
+        mapa->dono[i] = (uint8_t)(i % num_cores);
+    }
+    for (int i = n - 1; i > 0; i--) {
+        int j = (int)sortearLimitado(gerador, (uint32_t)(i + 1));
+        uint8_t t = mapa->dono[i];
+        mapa->dono[i] = mapa->dono[j];
+        mapa->dono[j] = t;
+    }
+
+    memset(mapa->territorios_por_cor, 0, sizeof(mapa->territorios_por_cor));
+    memset(mapa->tropas_por_cor, 0, sizeof(mapa->tropas_por_cor));
+    mapa->tropas_total = 0;
+    for (int i = 0; i < n; i++) {
+        mapa->tropas[i] = 1 + (int)sortearLimitado(gerador, 5);
+        mapa->territorios_por_cor[mapa->dono[i]]++;
+        mapa->tropas_por_cor[mapa->dono[i]] += mapa->tropas[i];
+        mapa->tropas_total += mapa->tropas[i];
+    }
+    reconstruirOrdemPorCor(mapa);
+}
+
+/**
+ * @brief Joga uma partida entre bots: a cada rodada, cada cor reforça e faz até
+ * IA_MAX_ATAQUES ataques escolhidos pela sua política.
+ * @return Índice da cor vencedora ou -1 se ninguém dominou o mapa em SIM_MAX_RODADAS.
+ */
+int jogarPartidaBots(Mapa* mapa, const JogadorIA jogadores[], int num_cores, LoteDados* lote, ResultadoPartidas* resultado) {
+    const int* posse = mapa->territorios_por_cor;
+    distribuirTerritorios(mapa, num_cores, lote->gerador);
+
+    for (int rodada = 1; rodada <= SIM_MAX_RODADAS; rodada++) {
+        for (int cor = 0; cor < num_cores; cor++) {
+            if (posse[cor] == 0) continue;
+
+            reforcarCor(mapa, cor, jogadores[cor].politica, lote->gerador);
+            Jogada jogada;
+            for (int ataque = 0; ataque < IA_MAX_ATAQUES && escolherJogada(&jogadores[cor], mapa, cor, IA_MAX_ATAQUES - ataque, lote->gerador, &jogada); ataque++) {
+                resultado->ataques++;
+                if (aplicarBatalha(mapa, jogada.atacante, jogada.defensor, lote) && posse[cor] == mapa->total) {
+                    resultado->rodadas += rodada;
+                    return cor;
+                }
+            }
+        }
+    }
+    resultado->rodadas += SIM_MAX_RODADAS;
+    return -1;
+}
+
+static void executarBlocoBots(long bloco, GeradorAleatorio* gerador, void* acumulador, const void* contexto) {
+    const struct ConfigBots* config = (const struct ConfigBots*)contexto;
+    ResultadoPartidas* resultado = (ResultadoPartidas*)acumulador;
+
+    long inicio = bloco * BLOCO_PARTIDAS;
+    long quantidade = config->partidas - inicio;
+    if (quantidade > BLOCO_PARTIDAS) quantidade = BLOCO_PARTIDAS;
+
+    // A grade e o grafo são montados uma vez por bloco; cada partida só redistribui os donos.
+    Arena arena;
+    iniciarArena(&arena);
+    Mapa* mapa = criarMapa(&arena, config->num_territorios);
+    if (mapa == NULL || montarGradeBots(mapa, config->num_territorios, config->num_cores) != 0) {
+        arenaLiberar(&arena);
+        resultado->sem_vencedor += quantidade;
+        return;
+    }
+
+    LoteDados lote;
+    iniciarLoteDados(&lote, gerador);
+    for (long p = 0; p < quantidade; p++) {
+        int vencedor = jogarPartidaBots(mapa, config->jogadores, config->num_cores, &lote, resultado);
+        if (vencedor >= 0) {
+            resultado->vitorias[vencedor]++;
+        } else {
+            resultado->sem_vencedor++;
+        }
+    }
+    arenaLiberar(&arena);
+}
+
+/**
+ * @brief Converte "mcts,gulosa,..." na lista de políticas (uma cor por nome).
+ * @return Quantidade de políticas lidas, ou -1 se algum nome for desconhecido.
+ */
+static int lerPoliticas(const char* texto, TipoPolitica politicas[], int max) {
+    int total = 0;
+    const char* inicio = texto;
+    while (*inicio != '\0') {
+        const char* fim = strchr(inicio, ',');
+        size_t tamanho = (fim != NULL) ? (size_t)(fim - inicio) : strlen(inicio);
+        int encontrada = -1;
+        for (int p = 0; p < (int)(sizeof(NOMES_POLITICAS) / sizeof(NOMES_POLITICAS[0])); p++) {
+            if (strlen(NOMES_POLITICAS[p]) == tamanho && strncmp(inicio, NOMES_POLITICAS[p], tamanho) == 0) {
+                encontrada = p;
+            }
+        }
+        if (encontrada < 0 || total == max) return -1;
+        politicas[total++] = (TipoPolitica)encontrada;
+        if (fim == NULL) break;
+        inicio = fim + 1;
+    }
+    return total;
+}
+
+/**
+ * @brief Roda 'partidas' partidas entre bots em paralelo e imprime a taxa de
+ * vitória de cada política e a vazão em partidas/min.
+ * @param tempo_jogada Segundos por decisão do MCTS (0: decide por max_rollouts).
+ * @return EXIT_SUCCESS ou EXIT_FAILURE (parâmetros inválidos).
+ */
+int executarPartidasBots(long partidas, int num_territorios, const char* politicas, double tempo_jogada, long max_rollouts,
+                         uint64_t semente, int num_threads) {
+    struct ConfigBots config;
+    TipoPolitica lidas[SIM_MAX_CORES];
+    int num_cores = lerPoliticas(politicas, lidas, SIM_MAX_CORES);
+    if (partidas < 1 || num_cores < 2 || num_territorios < num_cores || max_rollouts < 1 || tempo_jogada < 0) {
+        fprintf(stderr, "Parâmetros inválidos: partidas >= 1, 2 a %d políticas (aleatoria, gulosa, mcts), territórios >= cores.\n",
+                SIM_MAX_CORES);
+        return EXIT_FAILURE;
+    }
+
+    TabelaBatalhas tabela;
+    iniciarTabelaBatalhas(&tabela);
+    if (garantirTabelaBatalhas(&tabela, IA_TABELA_TROPAS, IA_TABELA_TROPAS) != 0) {
+        perror("Erro na alocação da tabela de probabilidades");
+        return EXIT_FAILURE;
+    }
+
+    // Poucas partidas: sobram threads para a busca de cada jogada.
+    int threads_busca = (partidas < num_threads) ? num_threads / (int)partidas : 1;
+    config.partidas = partidas;
+    config.num_territorios = num_territorios;
+    config.num_cores = num_cores;
+    for (int c = 0; c < num_cores; c++) {
+        config.jogadores[c].politica = lidas[c];
+        config.jogadores[c].tempo_jogada = tempo_jogada;
+        config.jogadores[c].max_rollouts = max_rollouts;
+        config.jogadores[c].threads = threads_busca;
+        config.jogadores[c].tabela = &tabela;
+    }
+
+    ResultadoPartidas resultado;
+    memset(&resultado, 0, sizeof(resultado));
+    double inicio = tempoAtualSegundos();
+    num_threads = executarEmParalelo((partidas + BLOCO_PARTIDAS - 1) / BLOCO_PARTIDAS, num_threads, semente,
+                                     executarBlocoBots, mesclarPartidas, &config, &resultado, sizeof(resultado));
+    if (num_threads < 0) {
+        perror("Erro ao iniciar o motor de simulação");
+        liberarTabelaBatalhas(&tabela);
+        return EXIT_FAILURE;
+    }
+    double decorrido = tempoAtualSegundos() - inicio;
+
+    printf("%ld partidas entre bots, %d territórios em grade (semente %llu, %d threads)\n", partidas, num_territorios,
+           (unsigned long long)semente, num_threads);
+    if (tempo_jogada > 0) {
+        printf("MCTS: %.1f ms por jogada\n", tempo_jogada * 1000.0);
+    } else {
+        printf("MCTS: %ld rollouts por jogada\n", max_rollouts);
+    }
+    for (int c = 0; c < num_cores; c++) {
+        printf("%-9s %-10s %6.4f\n", CORES_SIMULACAO[c], NOMES_POLITICAS[lidas[c]], (double)resultado.vitorias[c] / (double)partidas);
+    }
+    printf("Sem vencedor %6.4f\n", (double)resultado.sem_vencedor / (double)partidas);
+    printf("Média de rodadas: %.1f, ataques: %lld\n", (double)resultado.rodadas / (double)partidas, resultado.ataques);
+    printf("%ld partidas em %.3f s (%.0f partidas/min)\n", partidas, decorrido,
+           decorrido > 0 ? (double)partidas * 60.0 / decorrido : 0.0);
+    liberarTabelaBatalhas(&tabela);
+    return EXIT_SUCCESS;
+}
 
-typedef struct Territorio Territorio;
+// --- Motor de Turnos (partidas com missões) ---
 
-// --- Protótipos das Funções ---
-void limparBufferEntrada();
-Territorio* alocarMapa(int *max_territorios);
-void liberarMemoria(Territorio* mapa, char* missao_alocada); // Atualizada
-void cadastrarTerritorio(Territorio* mapa, int max_territorios, int *total_territorios);
-void exibirTerritorios(const Territorio* mapa, int total_territorios);
+// Catálogo das partidas com turnos (--turnos). Os alvos usam as cores de
+// CORES_SIMULACAO e as quantidades valem para o tabuleiro padrão de
+// SIM_TERRITORIOS_PADRAO territórios; escalarMissoesTurnos as ajusta a outros tamanhos.
+static const DefinicaoMissao MISSOES_TURNOS[] = {
+    {MISSAO_POSSUIR_TERRITORIOS, "Conquistar 12 territórios seguidos.", 12, NULL},
+    {MISSAO_ELIMINAR_COR, "Eliminar todas as tropas da cor Azul do mapa.", 0, "Azul"},
+    {MISSAO_ELIMINAR_COR, "Eliminar todas as tropas da cor Vermelho do mapa.", 0, "Vermelho"},
+    {MISSAO_ELIMINAR_COR, "Eliminar todas as tropas da cor Verde do mapa.", 0, "Verde"},
+    {MISSAO_TOTAL_TROPAS, "Ter mais de 100 tropas no total.", 100, NULL}
+};
 
-// Funções de Missão
-void atribuirMissao(char* destino, const char* missoes[], int totalMissoes);
-int verificarMissao(const char* missao, const Territorio* mapa, int total_territorios);
-void exibirMissao(const char* missao);
+#define TOTAL_MISSOES_TURNOS ((int)(sizeof(MISSOES_TURNOS) / sizeof(MISSOES_TURNOS[0])))
+#define TURNOS_TEXTO_MISSAO 64 // descrição de uma missão escalada
 
-// Funções de Ataque
-int rolarDado();
-void atacar(Territorio* atacante, Territorio* defensor);
-void iniciarAtaque(Territorio* mapa, int total_territorios, char* missao_do_jogador, int *jogo_vencido);
+/**
+ * @brief Copia MISSOES_TURNOS com as quantidades proporcionais ao tamanho do mapa.
+ * As tropas iniciais crescem com o número de territórios, então os limiares do
+ * tabuleiro padrão seriam inalcançáveis num mapa pequeno e imediatos num grande.
+ * No tabuleiro padrão a cópia é igual ao catálogo.
+ * @param destino Recebe TOTAL_MISSOES_TURNOS missões.
+ * @param textos Guardam as descrições reescritas; precisam viver tanto quanto destino.
+ * @param num_territorios Territórios do mapa da partida.
+ */
+static void escalarMissoesTurnos(DefinicaoMissao destino[], char textos[][TURNOS_TEXTO_MISSAO], int num_territorios) {
+    for (int m = 0; m < TOTAL_MISSOES_TURNOS; m++) {
+        destino[m] = MISSOES_TURNOS[m];
+        long long escalada = ((long long)MISSOES_TURNOS[m].quantidade * num_territorios + SIM_TERRITORIOS_PADRAO / 2) /
+                             SIM_TERRITORIOS_PADRAO;
+        int quantidade = (escalada > INT_MAX) ? INT_MAX : (int)escalada;
+        if (destino[m].tipo == MISSAO_POSSUIR_TERRITORIOS) {
+            // Pelo menos dois seguidos; no máximo o mapa inteiro.
+            if (quantidade < 2) quantidade = 2;
+            if (quantidade > num_territorios) quantidade = num_territorios;
+            snprintf(textos[m], TURNOS_TEXTO_MISSAO, "Conquistar %d territórios seguidos.", quantidade);
+        } else if (destino[m].tipo == MISSAO_TOTAL_TROPAS) {
+            if (quantidade < 1) quantidade = 1;
+            snprintf(textos[m], TURNOS_TEXTO_MISSAO, "Ter mais de %d tropas no total.", quantidade);
+        } else {
+            continue;
+        }
+        destino[m].quantidade = quantidade;
+        destino[m].descricao = textos[m];
+    }
+}
 
-// --- Implementação das Funções ---
+static const char* NOMES_FASES[TOTAL_FASES] = {"reforço", "ataque", "fortificação"};
 
 /**
- * @brief Limpa o buffer de entrada do teclado (stdin).
+ * @brief Fortificação: leva as tropas do território interior (sem vizinho
+ * inimigo) mais forte para o vizinho da mesma cor mais fraco na linha de
+ * frente, deixando 1 para trás. Sem fronteiras todo território é linha de
+ * frente, então não há o que fazer. A política aleatória não fortifica.
+ * @return 1 se moveu tropas, 0 caso contrário.
  */
-void limparBufferEntrada() {
-    int c;
-    while ((c = getchar()) != '\n' && c != EOF);
+int fortificarCor(Mapa* mapa, int cor, TipoPolitica politica) {
+    if (politica == POLITICA_ALEATORIA || mapa->total_fronteiras == 0 || atualizarGrafo(mapa) != 0) return 0;
+
+    const int* da_cor = territoriosDaCor(mapa, cor);
+    int origem = -1;
+    for (int k = 0; k < mapa->territorios_por_cor[cor]; k++) {
+        int i = da_cor[k];
+        if (mapa->tropas[i] > 1 &&
+            (origem < 0 || mapa->tropas[i] > mapa->tropas[origem] || (mapa->tropas[i] == mapa->tropas[origem] && i < origem)) &&
+            !temVizinhoInimigo(mapa, i)) {
+            origem = i;
+        }
+    }
+    if (origem < 0) return 0;
+
+    int destino = -1;
+    for (int k = mapa->grafo_inicio[origem]; k < mapa->grafo_inicio[origem + 1]; k++) {
+        int v = mapa->grafo_vizinhos[k];
+        if (mapa->dono[v] == cor && (destino < 0 || mapa->tropas[v] < mapa->tropas[destino]) && temVizinhoInimigo(mapa, v)) {
+            destino = v;
+        }
+    }
+    if (destino < 0) return 0;
+
+    int mover = mapa->tropas[origem] - 1;
+    alterarTropas(mapa, origem, -mover);
+    alterarTropas(mapa, destino, mover);
+    return 1;
 }
 
 /**
- * @brief Aloca dinamicamente memória para o vetor de territórios.
+ * @brief Vitória de um jogador: cumpriu a missão ou dominou o mapa inteiro.
  */
-Territorio* alocarMapa(int *max_territorios) {
-    int tamanho;
-    char temp_str[MAX_BUFFER];
+static int cumpriuObjetivo(const Mapa* mapa, const Jogador* jogador) {
+    return mapa->territorios_por_cor[jogador->cor] == mapa->total || verificarMissao(&jogador->missao, mapa);
+}
 
-    printf("=================================================\n");
-    printf("Quantos territórios no máximo o mapa terá? ");
-    
-    if (fgets(temp_str, MAX_BUFFER, stdin) != NULL) {
-        if (sscanf(temp_str, "%d", &tamanho) == 1 && tamanho > 0) {
-            *max_territorios = tamanho;
-            Territorio* mapa = (Territorio*)calloc(*max_territorios, sizeof(Territorio));
-            if (mapa == NULL) {
-                perror("Erro na alocação do mapa");
-                exit(EXIT_FAILURE);
-            }
-            printf("Memória alocada com sucesso para %d territórios.\n", *max_territorios);
-            return mapa;
+typedef void (*FuncaoFase)(Partida* partida, Jogador* jogador);
+
+static void faseReforco(Partida* partida, Jogador* jogador) {
+    reforcarCor(partida->mapa, jogador->cor, jogador->controle.politica, partida->lote->gerador);
+}
+
+static void faseAtaque(Partida* partida, Jogador* jogador) {
+    Mapa* mapa = partida->mapa;
+    Jogada jogada;
+    for (int ataque = 0; ataque < IA_MAX_ATAQUES && escolherJogada(&jogador->controle, mapa, jogador->cor, IA_MAX_ATAQUES - ataque,
+                                                                   partida->lote->gerador, &jogada); ataque++) {
+        partida->ataques++;
+        // Só uma conquista muda o que a missão confere: basta olhar depois delas.
+        if (aplicarBatalha(mapa, jogada.atacante, jogada.defensor, partida->lote) && cumpriuObjetivo(mapa, jogador)) {
+            partida->vencedor = (int)(jogador - partida->jogadores);
+            return;
         }
     }
-    
-    // Fallback
-    *max_territorios = 5;
-    Territorio* mapa = (Territorio*)calloc(*max_territorios, sizeof(Territorio));
-    if (mapa == NULL) {
-        perror("Erro na alocação do mapa");
-        exit(EXIT_FAILURE);
+}
+
+static void faseFortificacao(Partida* partida, Jogador* jogador) {
+    partida->fortificacoes += fortificarCor(partida->mapa, jogador->cor, jogador->controle.politica);
+}
+
+// O turno é esta tabela: acrescentar uma fase é acrescentar uma entrada (e um valor em FaseTurno).
+static const FuncaoFase FASES_TURNO[TOTAL_FASES] = {faseReforco, faseAtaque, faseFortificacao};
+
+/**
+ * @brief Prepara uma partida no mapa já distribuído: sorteia a missão de cada
+ * jogador (com a sua cor) e começa pelo reforço do primeiro.
+ */
+void iniciarPartida(Partida* partida, Mapa* mapa, Jogador jogadores[], int num_jogadores, const DefinicaoMissao missoes[],
+                    int total_missoes, LoteDados* lote) {
+    partida->mapa = mapa;
+    partida->jogadores = jogadores;
+    partida->num_jogadores = num_jogadores;
+    partida->vez = 0;
+    partida->fase = FASE_REFORCO;
+    partida->rodada = 1;
+    partida->vencedor = -1;
+    partida->lote = lote;
+    partida->ataques = 0;
+    partida->fortificacoes = 0;
+    for (int j = 0; j < num_jogadores; j++) {
+        atribuirMissao(&jogadores[j].missao, missoes, total_missoes, mapa, jogadores[j].cor, lote->gerador);
     }
-    printf("Entrada inválida. Usando o padrão de 5 territórios.\n");
-    return mapa;
 }
 
 /**
- * @brief Libera a memória alocada dinamicamente (Mapa e Missão).
- * @param mapa Ponteiro para o array de territórios.
- * @param missao_alocada Ponteiro para a string de missão.
+ * @brief Executa a fase atual do jogador da vez e passa para a seguinte, ou para
+ * o próximo jogador que ainda tem territórios. A missão é conferida ao fim de
+ * cada fase (e a cada conquista, no ataque).
+ * @return 1 se a partida continua, 0 se alguém venceu ou acabaram as SIM_MAX_RODADAS rodadas.
  */
-void liberarMemoria(Territorio* mapa, char* missao_alocada) {
-    if (mapa != NULL) {
-        free(mapa);
-        printf("\nMemória do mapa liberada.\n");
+int avancarFase(Partida* partida) {
+    if (partida->vencedor >= 0 || partida->rodada > SIM_MAX_RODADAS) return 0;
+
+    Jogador* jogador = &partida->jogadores[partida->vez];
+    if (partida->mapa->territorios_por_cor[jogador->cor] > 0) {
+        FASES_TURNO[partida->fase](partida, jogador);
+        if (partida->vencedor < 0 && cumpriuObjetivo(partida->mapa, jogador)) {
+            partida->vencedor = partida->vez;
+        }
+        if (partida->vencedor >= 0) return 0;
+        if (partida->fase + 1 < TOTAL_FASES) {
+            partida->fase = (FaseTurno)(partida->fase + 1);
+            return 1;
+        }
     }
-    if (missao_alocada != NULL) {
-        free(missao_alocada);
-        printf("Memória da missão liberada.\n");
+
+    partida->fase = FASE_REFORCO;
+    if (++partida->vez == partida->num_jogadores) {
+        partida->vez = 0;
+        partida->rodada++;
     }
+    return partida->rodada <= SIM_MAX_RODADAS;
 }
 
 /**
- * @brief Cadastra um novo território no mapa.
+ * @brief Joga a partida até o fim.
+ * @return Índice do jogador vencedor ou -1 se ninguém venceu em SIM_MAX_RODADAS rodadas.
  */
-void cadastrarTerritorio(Territorio* mapa, int max_territorios, int *total_territorios) {
-    printf("\n--- Cadastro de Território ---\n");
-    
-    Territorio* novo_territorio = mapa + *total_territorios;
+int jogarPartida(Partida* partida) {
+    while (avancarFase(partida)) {
+    }
+    return partida->vencedor;
+}
 
-    if(*total_territorios < max_territorios) {
-        
-        char temp_str[MAX_BUFFER]; 
+struct ConfigTurnos {
+    long partidas;
+    int num_territorios;
+    int num_jogadores;
+    JogadorIA controles[SIM_MAX_CORES];
+    DefinicaoMissao missoes[TOTAL_MISSOES_TURNOS]; // catálogo escalado para num_territorios
+    char textos_missoes[TOTAL_MISSOES_TURNOS][TURNOS_TEXTO_MISSAO];
+};
 
-        // Leitura segura da Cor e Nome
-        printf("Digite a cor da tropa (Ex: Azul): ");
-        fgets(novo_territorio->cor, COR_MAX, stdin);
-        novo_territorio->cor[strcspn(novo_territorio->cor, "\n")] = 0; 
+struct ResultadoTurnos {
+    long long vitorias[SIM_MAX_CORES];
+    long long vitorias_missao[TOTAL_MISSOES_TURNOS]; // vitórias por missão do catálogo
+    long long dominacoes;                            // vitórias por dominar o mapa antes da missão
+    long long sem_vencedor;
+    long long rodadas;
+    long long fases;
+    long long ataques;
+    long long fortificacoes;
+};
 
-        printf("Digite o nome do teritório (Ex: Brasil): ");
-        fgets(novo_territorio->nome, NOME_MAX, stdin);
-        novo_territorio->nome[strcspn(novo_territorio->nome, "\n")] = 0; 
+static void executarBlocoTurnos(long bloco, GeradorAleatorio* gerador, void* acumulador, const void* contexto) {
+    const struct ConfigTurnos* config = (const struct ConfigTurnos*)contexto;
+    struct ResultadoTurnos* resultado = (struct ResultadoTurnos*)acumulador;
 
-        // Leitura segura das Tropas
-        printf("Digite a quantidade de tropas (Mín. 1): ");
-        if (fgets(temp_str, MAX_BUFFER, stdin) != NULL && sscanf(temp_str, "%d", &novo_territorio->tropas) == 1 && novo_territorio->tropas >= 1) {
-            (*total_territorios)++;
-            printf("\n** Território '%s' registrado com sucesso! **\n", novo_territorio->nome);
+    long inicio = bloco * BLOCO_PARTIDAS;
+    long quantidade = config->partidas - inicio;
+    if (quantidade > BLOCO_PARTIDAS) quantidade = BLOCO_PARTIDAS;
+
+    // Mesmo tabuleiro dos bots: montado uma vez por bloco, redistribuído a cada partida.
+    Arena arena;
+    iniciarArena(&arena);
+    Mapa* mapa = criarMapa(&arena, config->num_territorios);
+    if (mapa == NULL || montarGradeBots(mapa, config->num_territorios, config->num_jogadores) != 0) {
+        arenaLiberar(&arena);
+        resultado->sem_vencedor += quantidade;
+        return;
+    }
+
+    LoteDados lote;
+    iniciarLoteDados(&lote, gerador);
+    Jogador jogadores[SIM_MAX_CORES];
+    for (long p = 0; p < quantidade; p++) {
+        distribuirTerritorios(mapa, config->num_jogadores, gerador);
+        for (int j = 0; j < config->num_jogadores; j++) {
+            jogadores[j].cor = j;
+            jogadores[j].controle = config->controles[j];
+        }
+
+        Partida partida;
+        iniciarPartida(&partida, mapa, jogadores, config->num_jogadores, config->missoes, TOTAL_MISSOES_TURNOS, &lote);
+        long long fases = 0;
+        while (avancarFase(&partida)) {
+            fases++;
+        }
+
+        int vencedor = partida.vencedor;
+        if (vencedor >= 0) {
+            resultado->vitorias[vencedor]++;
+            if (verificarMissao(&jogadores[vencedor].missao, mapa)) {
+                resultado->vitorias_missao[jogadores[vencedor].missao.indice]++;
+            } else {
+                resultado->dominacoes++;
+            }
         } else {
-            printf("\n** ERRO: Quantidade de tropas inválida (Deve ser um número inteiro >= 1). **\n");
+            resultado->sem_vencedor++;
         }
-        
-    } else {
-        printf("\n** Número de territórios máximo (%d) atingido! **\n", max_territorios);
+        resultado->rodadas += partida.rodada > SIM_MAX_RODADAS ? SIM_MAX_RODADAS : partida.rodada;
+        resultado->fases += fases + 1;
+        resultado->ataques += partida.ataques;
+        resultado->fortificacoes += partida.fortificacoes;
+    }
+    arenaLiberar(&arena);
+}
+
+static void mesclarTurnos(void* destino, const void* origem, const void* contexto) {
+    (void)contexto;
+    struct ResultadoTurnos* d = (struct ResultadoTurnos*)destino;
+    const struct ResultadoTurnos* o = (const struct ResultadoTurnos*)origem;
+    for (int j = 0; j < SIM_MAX_CORES; j++) {
+        d->vitorias[j] += o->vitorias[j];
+    }
+    for (int m = 0; m < TOTAL_MISSOES_TURNOS; m++) {
+        d->vitorias_missao[m] += o->vitorias_missao[m];
     }
+    d->dominacoes += o->dominacoes;
+    d->sem_vencedor += o->sem_vencedor;
+    d->rodadas += o->rodadas;
+    d->fases += o->fases;
+    d->ataques += o->ataques;
+    d->fortificacoes += o->fortificacoes;
 }
 
 /**
- * @brief Exibe todos os territórios cadastrados.
+ * @brief Roda 'partidas' partidas completas (reforço, ataque e fortificação,
+ * cada jogador com a sua missão) em paralelo e sem tela, e imprime vitórias por
+ * jogador e por missão e a vazão em partidas/s.
+ * @param politicas Uma política por jogador ("gulosa,mcts,..."); o jogador i joga com a cor CORES_SIMULACAO[i].
+ * @return EXIT_SUCCESS ou EXIT_FAILURE (parâmetros inválidos).
  */
-void exibirTerritorios(const Territorio* mapa, int total_territorios) {
-    printf("\n--- Lista de Territórios/Tropas ---\n");
+int executarPartidasTurnos(long partidas, int num_territorios, const char* politicas, double tempo_jogada,
+                           long max_rollouts, uint64_t semente, int num_threads) {
+    struct ConfigTurnos config;
+    TipoPolitica lidas[SIM_MAX_CORES];
+    int num_jogadores = lerPoliticas(politicas, lidas, SIM_MAX_CORES);
+    if (partidas < 1 || num_jogadores < 2 || num_territorios < num_jogadores || max_rollouts < 1 || tempo_jogada < 0) {
+        fprintf(stderr, "Parâmetros inválidos: partidas >= 1, 2 a %d políticas (aleatoria, gulosa, mcts), territórios >= jogadores.\n",
+                SIM_MAX_CORES);
+        return EXIT_FAILURE;
+    }
 
-    if(total_territorios == 0) {
-        printf("Nenhum território/tropa foi cadastrado.\n");
-    } else {
-        for(int i = 0; i < total_territorios; i++) {
-            printf("=================================================\n"); 
-            printf("ID: %d\n", i);
-            printf("Nome: %s\n", (mapa + i)->nome);
-            printf("Cor: %s\n", (mapa + i)->cor);
-            printf("Tropas: %d\n", (mapa + i)->tropas); 
-        }
-        printf("=================================================\n");
+    TabelaBatalhas tabela;
+    iniciarTabelaBatalhas(&tabela);
+    if (garantirTabelaBatalhas(&tabela, IA_TABELA_TROPAS, IA_TABELA_TROPAS) != 0) {
+        perror("Erro na alocação da tabela de probabilidades");
+        return EXIT_FAILURE;
+    }
+
+    int threads_busca = (partidas < num_threads) ? num_threads / (int)partidas : 1;
+    config.partidas = partidas;
+    config.num_territorios = num_territorios;
+    config.num_jogadores = num_jogadores;
+    escalarMissoesTurnos(config.missoes, config.textos_missoes, num_territorios);
+    for (int j = 0; j < num_jogadores; j++) {
+        config.controles[j].politica = lidas[j];
+        config.controles[j].tempo_jogada = tempo_jogada;
+        config.controles[j].max_rollouts = max_rollouts;
+        config.controles[j].threads = threads_busca;
+        config.controles[j].tabela = &tabela;
+    }
+
+    struct ResultadoTurnos resultado;
+    memset(&resultado, 0, sizeof(resultado));
+    double inicio = tempoAtualSegundos();
+    num_threads = executarEmParalelo((partidas + BLOCO_PARTIDAS - 1) / BLOCO_PARTIDAS, num_threads, semente,
+                                     executarBlocoTurnos, mesclarTurnos, &config, &resultado, sizeof(resultado));
+    if (num_threads < 0) {
+        perror("Erro ao iniciar o motor de simulação");
+        liberarTabelaBatalhas(&tabela);
+        return EXIT_FAILURE;
     }
+    double decorrido = tempoAtualSegundos() - inicio;
+
+    printf("%ld partidas com turnos (%s, %s, %s), %d territórios em grade (semente %llu, %d threads)\n", partidas,
+           NOMES_FASES[FASE_REFORCO], NOMES_FASES[FASE_ATAQUE], NOMES_FASES[FASE_FORTIFICACAO], num_territorios,
+           (unsigned long long)semente, num_threads);
+    for (int j = 0; j < num_jogadores; j++) {
+        printf("Jogador %d  %-9s %-10s %6.4f\n", j + 1, CORES_SIMULACAO[j], NOMES_POLITICAS[lidas[j]],
+               (double)resultado.vitorias[j] / (double)partidas);
+    }
+    printf("Sem vencedor %6.4f\n", (double)resultado.sem_vencedor / (double)partidas);
+    printf("Vitórias por missão:\n");
+    for (int m = 0; m < TOTAL_MISSOES_TURNOS; m++) {
+        printf("  %-52s %lld\n", config.missoes[m].descricao, resultado.vitorias_missao[m]);
+    }
+    printf("  %-52s %lld\n", "Dominar o mapa inteiro.", resultado.dominacoes);
+    printf("Média por partida: %.1f rodadas, %.1f fases, %.1f ataques, %.1f fortificações\n",
+           (double)resultado.rodadas / (double)partidas, (double)resultado.fases / (double)partidas,
+           (double)resultado.ataques / (double)partidas, (double)resultado.fortificacoes / (double)partidas);
+    printf("%ld partidas em %.3f s (%.0f partidas/s)\n", partidas, decorrido,
+           decorrido > 0 ? (double)partidas / decorrido : 0.0);
+    liberarTabelaBatalhas(&tabela);
+    return EXIT_SUCCESS;
 }
 
-/**
- * @brief Sorteia uma missão e a copia para o destino (Passagem por referência).
- * @param destino Ponteiro para onde a missão será copiada.
- * @param missoes Vetor de strings com as missões disponíveis.
- * @param totalMissoes Número total de missões.
- */
-void atribuirMissao(char* destino, const char* missoes[], int totalMissoes) {
-    int indice = rand() % totalMissoes;
-    // Copia a missão sorteada (string) para o espaço alocado (destino)
-    strcpy(destino, missoes[indice]); 
+// --- Benchmarks (--benchmark) ---
+
+// Estado compartilhado pelas medições de um tamanho de mapa.
+struct ContextoBenchmark {
+    Arena* arena;
+    Mapa* mapa;
+    Missao missao;
+    GeradorAleatorio gerador;
+    const char* caminho_snapshot;
+    const char* caminho_cenario;
+    SaidaBuffer saida;
+    int resultado; // acumula retornos para o compilador não descartar as chamadas
+};
+
+typedef void (*FuncaoBenchmark)(struct ContextoBenchmark* contexto, long repeticoes);
+
+struct Benchmark {
+    const char* nome;
+    FuncaoBenchmark executar;
+    int silenciar;      // escreve na tela: a saída vai para /dev/null durante a medição
+    TipoMissao missao;  // missão usada por benchVerificarMissao
+};
+
+static void benchRolarDado(struct ContextoBenchmark* contexto, long repeticoes) {
+    for (long r = 0; r < repeticoes; r++) {
+        contexto->resultado += rolarDado(&contexto->gerador);
+    }
 }
 
 /**
- * @brief Exibe a missão do jogador (Passagem por valor/constante).
- * @param missao String contendo a missão.
+ * @brief Escolhe um par atacante/defensor vizinho na grade (o da direita) e
+ * repõe tropas quando o atacante fica sem condições de atacar.
  */
-void exibirMissao(const char* missao) {
-    printf("\n=================================================\n");
-    printf("SUA MISSÃO SECRETA: %s\n", missao);
-    printf("=================================================\n");
+static int prepararAtaque(struct ContextoBenchmark* contexto, int* defensor) {
+    Mapa* mapa = contexto->mapa;
+    int atacante = (int)sortearLimitado(&contexto->gerador, (uint32_t)mapa->total);
+    *defensor = (atacante + 1) % mapa->total;
+    if (mapa->tropas[atacante] < 2) {
+        alterarTropas(mapa, atacante, 5);
+    }
+    return atacante;
 }
 
-/**
- * @brief Verifica se a missão do jogador foi cumprida (Passagem por referência/constante).
- * @param missao String contendo a missão.
- * @param mapa Ponteiro para o array de territórios.
- * @param total_territorios Número de territórios cadastrados.
- * @return 1 se a missão foi cumprida, 0 caso contrário.
- */
-int verificarMissao(const char* missao, const Territorio* mapa, int total_territorios) {
-    
-    // LÓGICA DE VERIFICAÇÃO SIMPLES BASEADA NA MISSÃO
-    
-    // 1. Missão: "Conquistar 3 territórios seguidos" (Simplificada para 'Possuir 3 ou mais territórios')
-    if (strstr(missao, "3 territórios") != NULL) {
-        int contador_meus_territorios = 0;
-        // Se a cor do primeiro território for a cor do "jogador"
-        const char* cor_jogador = (total_territorios > 0) ? mapa->cor : ""; 
+static void benchAtacar(struct ContextoBenchmark* contexto, long repeticoes) {
+    for (long r = 0; r < repeticoes; r++) {
+        int defensor;
+        int atacante = prepararAtaque(contexto, &defensor);
+        atacar(contexto->mapa, atacante, defensor, &contexto->gerador, &contexto->saida);
+        descarregarSaida(&contexto->saida);
+    }
+}
 
-        if (strlen(cor_jogador) == 0) return 0; // Nenhum território cadastrado
+static void benchAtacarSilencioso(struct ContextoBenchmark* contexto, long repeticoes) {
+    for (long r = 0; r < repeticoes; r++) {
+        int defensor;
+        int atacante = prepararAtaque(contexto, &defensor);
+        atacar(contexto->mapa, atacante, defensor, &contexto->gerador, NULL);
+    }
+}
 
-        for (int i = 0; i < total_territorios; i++) {
-            if (strcmp((mapa + i)->cor, cor_jogador) == 0) {
-                contador_meus_territorios++;
-            }
-        }
-        return (contador_meus_territorios >= 3);
+// O mesmo ataque com a instrumentação ligada (sem trace): custo dos contadores e do relógio.
+static void benchAtacarInstrumentado(struct ContextoBenchmark* contexto, long repeticoes) {
+    iniciarInstrumentacao(NULL);
+    benchAtacarSilencioso(contexto, repeticoes);
+    instrumentacao.ativa = 0;
+}
+
+static void benchAplicarCombate(struct ContextoBenchmark* contexto, long repeticoes) {
+    for (long r = 0; r < repeticoes; r++) {
+        int defensor;
+        int atacante = prepararAtaque(contexto, &defensor);
+        RodadaCombate rodada;
+        rolarRodada(&rodada, contexto->mapa->tropas[atacante], contexto->mapa->tropas[defensor], &contexto->gerador);
+        contexto->resultado += aplicarCombate(contexto->mapa, atacante, defensor, &rodada);
     }
-    
-    // 2. Missão: "Eliminar todas as tropas da cor vermelha" (Simplificada para 'Nenhuma tropa Vermelha no mapa')
-    if (strstr(missao, "cor vermelha") != NULL) {
-        for (int i = 0; i < total_territorios; i++) {
-            if (strcmp((mapa + i)->cor, "Vermelho") == 0) {
-                return 0; // Missão não cumprida: ainda há Vermelho
-            }
-        }
-        // Se o loop terminar e houver pelo menos um território, a missão é cumprida.
-        return (total_territorios > 0); 
+}
+
+// Batalha relâmpago entre exércitos grandes (não depende do mapa: medida uma vez só).
+static void benchBatalhaRelampago(struct ContextoBenchmark* contexto, long repeticoes) {
+    LoteDados lote;
+    iniciarLoteDados(&lote, &contexto->gerador);
+    for (long r = 0; r < repeticoes; r++) {
+        int tropas_atacante = 1000;
+        int tropas_defensor = 1000;
+        contexto->resultado += batalhaRelampago(&tropas_atacante, &tropas_defensor, &lote);
     }
-    
-    // 3. Missão: "Ter mais de 10 tropas no total"
-    if (strstr(missao, "mais de 10 tropas") != NULL) {
-        int total_tropas = 0;
-        for (int i = 0; i < total_territorios; i++) {
-            total_tropas += (mapa + i)->tropas;
-        }
-        return (total_tropas > 10);
+}
+
+static void benchVerificarMissao(struct ContextoBenchmark* contexto, long repeticoes) {
+    for (long r = 0; r < repeticoes; r++) {
+        contexto->resultado += verificarMissao(&contexto->missao, contexto->mapa);
     }
+}
 
-    // Se a missão não tiver uma regra definida, nunca cumpre (para ser seguro)
-    return 0; 
+// Nome sorteado a cada consulta (a montagem do nome entra na medida).
+static void benchBuscarTerritorio(struct ContextoBenchmark* contexto, long repeticoes) {
+    char nome[NOME_MAX];
+    for (long r = 0; r < repeticoes; r++) {
+        snprintf(nome, NOME_MAX, "T%u", sortearLimitado(&contexto->gerador, (uint32_t)contexto->mapa->total));
+        contexto->resultado += buscarTerritorio(contexto->mapa, nome) >= 0;
+    }
+}
+
+static void benchExibirTerritorios(struct ContextoBenchmark* contexto, long repeticoes) {
+    for (long r = 0; r < repeticoes; r++) {
+        exibirTerritorios(contexto->mapa);
+    }
+}
+
+static void benchExibirTabela(struct ContextoBenchmark* contexto, long repeticoes) {
+    // Uma página filtrada: a varredura é do mapa todo, a formatação só de 20 linhas.
+    FiltroTerritorios filtro = {0, 2, 2, EXIBICAO_POR_PAGINA};
+    for (long r = 0; r < repeticoes; r++) {
+        exibirTabelaTerritorios(contexto->mapa, &filtro, &contexto->saida);
+        descarregarSaida(&contexto->saida);
+    }
+}
+
+static void benchSalvarSnapshot(struct ContextoBenchmark* contexto, long repeticoes) {
+    for (long r = 0; r < repeticoes; r++) {
+        contexto->resultado += salvarSnapshot(contexto->caminho_snapshot, contexto->mapa, &contexto->missao, &contexto->gerador);
+    }
 }
 
 /**
- * @brief Simula o ataque rolando um dado (1 a 6).
+ * @brief Descarta um mapa carregado sem a mensagem de liberarMemoria().
  */
-int rolarDado() {
-    return (rand() % 6) + 1;
+static void descartarMapa(Mapa* mapa, Arena* arena) {
+    if (mapa != NULL && mapa->mapeamento != NULL) {
+        munmap(mapa->mapeamento, mapa->tamanho_mapeamento);
+    }
+    arenaLiberar(arena);
+}
+
+static void benchCarregarSnapshot(struct ContextoBenchmark* contexto, long repeticoes) {
+    for (long r = 0; r < repeticoes; r++) {
+        Arena arena;
+        Missao missao;
+        GeradorAleatorio gerador;
+        iniciarArena(&arena);
+        Mapa* mapa = carregarSnapshot(contexto->caminho_snapshot, &arena, &missao, &gerador);
+        contexto->resultado += (mapa != NULL) ? mapa->total : -1;
+        descartarMapa(mapa, &arena);
+    }
+}
+
+static void benchImportarCenario(struct ContextoBenchmark* contexto, long repeticoes) {
+    for (long r = 0; r < repeticoes; r++) {
+        Arena arena;
+        EstatisticasImportacao estatisticas;
+        iniciarArena(&arena);
+        Mapa* mapa = criarMapa(&arena, CAPACIDADE_INICIAL);
+        contexto->resultado += (mapa != NULL) ? importarCenario(contexto->caminho_cenario, mapa, &estatisticas) : -1;
+        descartarMapa(mapa, &arena);
+    }
 }
 
 /**
- * @brief Simula a batalha entre dois territórios e atualiza seus estados.
+ * @brief Grava o mapa do benchmark como cenário CSV (territórios + fronteiras).
+ * @return 0 em caso de sucesso, -1 em erro de escrita.
  */
-void atacar(Territorio* atacante, Territorio* defensor) {
-    int dado_ataque = rolarDado();
-    int dado_defesa = rolarDado();
-    
-    printf("\n--- Batalha: %s vs. %s ---\n", atacante->nome, defensor->nome);
-    printf("Dado Ataque (%s): %d\n", atacante->nome, dado_ataque);
-    printf("Dado Defesa (%s): %d\n", defensor->nome, dado_defesa);
+static int escreverCenarioBenchmark(const char* caminho, const Mapa* mapa) {
+    FILE* arquivo = fopen(caminho, "w");
+    if (arquivo == NULL) return -1;
 
-    if (atacante->tropas < 1) {
-        printf("Ataque cancelado: %s não tem tropas suficientes para atacar.\n", atacante->nome);
-        return;
+    fprintf(arquivo, "nome,cor,tropas\n");
+    for (int i = 0; i < mapa->total; i++) {
+        fprintf(arquivo, "%s,%s,%d\n", mapa->nomes[i], nomeDaCor(mapa, mapa->dono[i]), mapa->tropas[i]);
     }
+    for (long f = 0; f < mapa->total_fronteiras; f++) {
+        fprintf(arquivo, "@%s,%s\n", mapa->nomes[mapa->fronteiras[f][0]], mapa->nomes[mapa->fronteiras[f][1]]);
+    }
+    return fclose(arquivo) == 0 ? 0 : -1;
+}
 
-    if (dado_ataque > dado_defesa) {
-        // Vitoria do Atacante: CONQUISTA
-        
-        // Atualiza o dono (cor)
-        strcpy(defensor->cor, atacante->cor);
-        
-        // Move metade das tropas (Passagem por referência implícita via ponteiro)
-        int tropas_movidas = atacante->tropas / 2;
-        
-        atacante->tropas -= tropas_movidas;
-        defensor->tropas = tropas_movidas; 
+/**
+ * @brief Mede um benchmark: dobra as repetições até a medição durar pelo menos
+ * BENCH_TEMPO_MINIMO e imprime uma linha (JSON ou CSV) com ns/op, ops/s e
+ * alocações por operação (heap + blocos de arena).
+ */
+static void medirBenchmark(const struct Benchmark* benchmark, struct ContextoBenchmark* contexto, int territorios,
+                           int formato_json, int* primeiro) {
+    int saida_original = -1;
+    if (benchmark->silenciar) {
+        fflush(stdout);
+        saida_original = dup(STDOUT_FILENO);
+        int nulo = open("/dev/null", O_WRONLY);
+        if (nulo >= 0) {
+            dup2(nulo, STDOUT_FILENO);
+            close(nulo);
+        }
+    }
+
+    long repeticoes = 1;
+    double decorrido;
+    long alocacoes;
+    long long bytes;
+    for (;;) {
+        long alocacoes_antes = atomic_load(&alocacoes_heap);
+        long long bytes_antes = atomic_load(&bytes_heap);
+        double inicio = tempoAtualSegundos();
+        benchmark->executar(contexto, repeticoes);
+        if (benchmark->silenciar) fflush(stdout);
+        decorrido = tempoAtualSegundos() - inicio;
+        alocacoes = atomic_load(&alocacoes_heap) - alocacoes_antes;
+        bytes = atomic_load(&bytes_heap) - bytes_antes;
+        if (decorrido >= BENCH_TEMPO_MINIMO || repeticoes >= BENCH_MAX_REPETICOES) break;
+        repeticoes *= 2;
+    }
 
-        printf("\n*** VITÓRIA! '%s' CONQUISTOU '%s'! ***\n", atacante->nome, defensor->nome);
-        printf("%d tropas movidas para o território conquistado.\n", tropas_movidas);
+    if (saida_original >= 0) {
+        dup2(saida_original, STDOUT_FILENO);
+        close(saida_original);
+    }
 
+    double ns_por_op = decorrido * 1e9 / (double)repeticoes;
+    double ops_por_s = decorrido > 0 ? (double)repeticoes / decorrido : 0.0;
+    if (formato_json) {
+        printf("%s    {\"benchmark\": \"%s\", \"territorios\": %d, \"repeticoes\": %ld, \"ns_por_op\": %.1f, "
+               "\"ops_por_s\": %.1f, \"alocacoes_por_op\": %.3f, \"bytes_por_op\": %.1f}",
+               *primeiro ? "" : ",\n", benchmark->nome, territorios, repeticoes, ns_por_op, ops_por_s,
+               (double)alocacoes / (double)repeticoes, (double)bytes / (double)repeticoes);
     } else {
-        // Derrota do Atacante: Perde 1 tropa 
-        if (atacante->tropas > 1) {
-            atacante->tropas -= 1;
-        } else {
-            atacante->tropas = 1; 
-        }
-        
-        printf("\n*** DERROTA! '%s' defendeu o ataque. ***\n", defensor->nome);
-        printf("O atacante '%s' perdeu 1 tropa. Tropas restantes: %d.\n", atacante->nome, atacante->tropas);
+        printf("%s,%d,%ld,%.1f,%.1f,%.3f,%.1f\n", benchmark->nome, territorios, repeticoes, ns_por_op, ops_por_s,
+               (double)alocacoes / (double)repeticoes, (double)bytes / (double)repeticoes);
     }
+    fflush(stdout);
+    *primeiro = 0;
 }
 
+// Medições que dependem do tamanho do mapa (rolarDado é medido uma vez só).
+static const struct Benchmark BENCHMARKS_MAPA[] = {
+    {"atacar", benchAtacar, 1, MISSAO_POSSUIR_TERRITORIOS},
+    {"atacar/silencioso", benchAtacarSilencioso, 0, MISSAO_POSSUIR_TERRITORIOS},
+    {"atacar/instrumentado", benchAtacarInstrumentado, 0, MISSAO_POSSUIR_TERRITORIOS},
+    {"aplicarCombate", benchAplicarCombate, 0, MISSAO_POSSUIR_TERRITORIOS},
+    {"verificarMissao/territorios_seguidos", benchVerificarMissao, 0, MISSAO_POSSUIR_TERRITORIOS},
+    {"verificarMissao/eliminar_cor", benchVerificarMissao, 0, MISSAO_ELIMINAR_COR},
+    {"verificarMissao/total_tropas", benchVerificarMissao, 0, MISSAO_TOTAL_TROPAS},
+    {"verificarMissao/possuir_territorio", benchVerificarMissao, 0, MISSAO_POSSUIR_TERRITORIO},
+    {"verificarMissao/maioria_territorios", benchVerificarMissao, 0, MISSAO_MAIORIA_TERRITORIOS},
+    {"buscarTerritorio", benchBuscarTerritorio, 0, MISSAO_POSSUIR_TERRITORIOS},
+    {"exibirTerritorios", benchExibirTerritorios, 1, MISSAO_POSSUIR_TERRITORIOS},
+    {"exibirTabelaTerritorios", benchExibirTabela, 1, MISSAO_POSSUIR_TERRITORIOS},
+    {"salvarSnapshot", benchSalvarSnapshot, 0, MISSAO_POSSUIR_TERRITORIOS},
+    {"carregarSnapshot", benchCarregarSnapshot, 0, MISSAO_POSSUIR_TERRITORIOS},
+    {"importarCenario", benchImportarCenario, 0, MISSAO_POSSUIR_TERRITORIOS},
+};
+
 /**
- * @brief Recebe o input do usuário e inicia a simulação de ataque.
- * @param missao_do_jogador Ponteiro para a missão (necessário para checar vitória).
- * @param jogo_vencido Ponteiro para flag de vitória (passagem por referência).
+ * @brief Roda todos os benchmarks para mapas de 5 até max_territorios
+ * territórios (grade com 4 cores) e imprime os resultados em JSON ou CSV.
+ * @return EXIT_SUCCESS ou EXIT_FAILURE.
  */
-void iniciarAtaque(Territorio* mapa, int total_territorios, char* missao_do_jogador, int *jogo_vencido) {
-    if (total_territorios < 2) {
-        printf("\nÉ necessário cadastrar no mínimo 2 territórios para atacar.\n");
-        return;
+int executarBenchmarks(const char* formato, int max_territorios, uint64_t semente) {
+    static const int TAMANHOS[] = {5, 100, 10000, 1000000};
+    int formato_json = (strcmp(formato, "json") == 0);
+    if ((!formato_json && strcmp(formato, "csv") != 0) || max_territorios < 5) {
+        fprintf(stderr, "Parâmetros inválidos: formato json ou csv, territórios >= 5.\n");
+        return EXIT_FAILURE;
     }
 
-    exibirTerritorios(mapa, total_territorios);
+    char caminho_snapshot[] = "/tmp/war-benchmark-XXXXXX";
+    char caminho_cenario[] = "/tmp/war-benchmark-XXXXXX";
+    int fd_snapshot = mkstemp(caminho_snapshot);
+    int fd_cenario = mkstemp(caminho_cenario);
+    if (fd_snapshot < 0 || fd_cenario < 0) {
+        perror("Erro ao criar os arquivos temporários do benchmark");
+        if (fd_snapshot >= 0) {
+            close(fd_snapshot);
+            unlink(caminho_snapshot);
+        }
+        if (fd_cenario >= 0) {
+            close(fd_cenario);
+            unlink(caminho_cenario);
+        }
+        return EXIT_FAILURE;
+    }
+    close(fd_snapshot);
+    close(fd_cenario);
 
-    int id_atacante, id_defensor;
-    char temp_str[MAX_BUFFER];
+    struct ContextoBenchmark contexto;
+    memset(&contexto, 0, sizeof(contexto));
+    iniciarGerador(&contexto.gerador, semente, 0);
+    contexto.caminho_snapshot = caminho_snapshot;
+    contexto.caminho_cenario = caminho_cenario;
+    iniciarSaida(&contexto.saida, stdout);
 
-    printf("\nDigite o ID do território ATACANTE: ");
-    if (fgets(temp_str, MAX_BUFFER, stdin) == NULL || sscanf(temp_str, "%d", &id_atacante) != 1 || id_atacante < 0 || id_atacante >= total_territorios) {
-        printf("ID do atacante inválido.\n");
-        return;
+    int primeiro = 1;
+    if (formato_json) {
+        printf("{\n  \"semente\": %llu,\n  \"resultados\": [\n", (unsigned long long)semente);
+    } else {
+        printf("benchmark,territorios,repeticoes,ns_por_op,ops_por_s,alocacoes_por_op,bytes_por_op\n");
     }
+    const struct Benchmark dado = {"rolarDado", benchRolarDado, 0, MISSAO_POSSUIR_TERRITORIOS};
+    medirBenchmark(&dado, &contexto, 0, formato_json, &primeiro);
+    const struct Benchmark relampago = {"batalhaRelampago/1000x1000", benchBatalhaRelampago, 0, MISSAO_POSSUIR_TERRITORIOS};
+    medirBenchmark(&relampago, &contexto, 0, formato_json, &primeiro);
 
-    printf("Digite o ID do território DEFENSOR: ");
-    if (fgets(temp_str, MAX_BUFFER, stdin) == NULL || sscanf(temp_str, "%d", &id_defensor) != 1 || id_defensor < 0 || id_defensor >= total_territorios) {
-        printf("ID do defensor inválido.\n");
-        return;
+    int status = EXIT_SUCCESS;
+    for (int t = 0; t < (int)(sizeof(TAMANHOS) / sizeof(TAMANHOS[0])) && TAMANHOS[t] <= max_territorios; t++) {
+        int territorios = TAMANHOS[t];
+        Arena arena;
+        iniciarArena(&arena);
+        contexto.arena = &arena;
+        contexto.mapa = criarMapa(&arena, territorios);
+        if (contexto.mapa == NULL || montarGradeBots(contexto.mapa, territorios, 4) != 0) {
+            perror("Erro ao montar o mapa do benchmark");
+            arenaLiberar(&arena);
+            status = EXIT_FAILURE;
+            break;
+        }
+        distribuirTerritorios(contexto.mapa, 4, &contexto.gerador);
+        if (escreverCenarioBenchmark(caminho_cenario, contexto.mapa) != 0) {
+            perror("Erro ao gravar o cenário do benchmark");
+            arenaLiberar(&arena);
+            status = EXIT_FAILURE;
+            break;
+        }
+        fprintf(stderr, "Medindo mapas de %d territórios...\n", territorios);
+
+        for (int b = 0; b < (int)(sizeof(BENCHMARKS_MAPA) / sizeof(BENCHMARKS_MAPA[0])); b++) {
+            // Missão com alvos fixos: território do meio e a última cor da grade.
+            memset(&contexto.missao, 0, sizeof(contexto.missao));
+            contexto.missao.tipo = BENCHMARKS_MAPA[b].missao;
+            contexto.missao.cor = -1;
+            contexto.missao.quantidade = (contexto.missao.tipo == MISSAO_TOTAL_TROPAS) ? 10 : 3;
+            contexto.missao.cor_alvo = 3;
+            contexto.missao.id_territorio_alvo = territorios / 2;
+            medirBenchmark(&BENCHMARKS_MAPA[b], &contexto, territorios, formato_json, &primeiro);
+        }
+        arenaLiberar(&arena);
     }
 
-    if (id_atacante == id_defensor) {
-        printf("Um território não pode atacar a si mesmo!\n");
-        return;
+    if (formato_json) {
+        printf("\n  ]\n}\n");
     }
+    unlink(caminho_snapshot);
+    unlink(caminho_cenario);
+    return status;
+}
 
-    Territorio* atacante = mapa + id_atacante;
-    Territorio* defensor = mapa + id_defensor;
+/**
+ * @brief Indica se argv[indice] existe e é um parâmetro posicional (não uma opção "--...").
+ */
+static int argumentoPosicional(int argc, char* argv[], int indice) {
+    if (indice >= argc) return 0;
+    for (int i = 2; i <= indice; i++) {
+        if (strncmp(argv[i], "--", 2) == 0) return 0;
+    }
+    return 1;
+}
 
-    // Validação: Não pode atacar o próprio time (mesma cor)
-    if (strcmp(atacante->cor, defensor->cor) == 0) {
-        printf("ERRO: O território atacante e defensor são da mesma cor (%s). Não é possível atacar aliados.\n", atacante->cor);
-        return;
+// --- Função Principal (Main) ---
+
+int main(int argc, char* argv[]) {
+    // Semente explícita (--semente N) torna a partida/simulação reproduzível.
+    uint64_t semente = (uint64_t)time(NULL);
+    int num_threads = numeroDeNucleos();
+    const char* arquivo_snapshot = NULL;
+    const char* arquivo_cenario = NULL;
+    double tempo_jogada = 0;
+    long max_rollouts = IA_ROLLOUTS_PADRAO;
+    int silencioso = 0;
+    int instrumentar = 0;
+    const char* arquivo_trace = NULL;
+    const char* arquivo_registro = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--silencioso") == 0) silencioso = 1;
+        if (strcmp(argv[i], "--instrumentar") == 0) instrumentar = 1;
+    }
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--semente") == 0) {
+            semente = strtoull(argv[i + 1], NULL, 10);
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            num_threads = atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "--carregar") == 0) {
+            arquivo_snapshot = argv[i + 1];
+        } else if (strcmp(argv[i], "--importar") == 0) {
+            arquivo_cenario = argv[i + 1];
+        } else if (strcmp(argv[i], "--tempo-jogada") == 0) {
+            tempo_jogada = atof(argv[i + 1]) / 1000.0;
+        } else if (strcmp(argv[i], "--rollouts") == 0) {
+            max_rollouts = atol(argv[i + 1]);
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            arquivo_trace = argv[i + 1];
+        } else if (strcmp(argv[i], "--gravar") == 0) {
+            arquivo_registro = argv[i + 1];
+        }
     }
 
-    if (atacante->tropas < 2) {
-        printf("O território atacante precisa de no mínimo 2 tropas (1 para atacar + 1 de reserva)!\n");
-        return;
+    // Modos não interativos:
+    //   ./war --simular [max_ataque] [max_defesa] [batalhas_por_celula]
+    //   ./war --simular-partidas [partidas] [territorios] [cores]
+    //   ./war --probabilidades [max_ataque] [max_defesa]
+    //   ./war --bots [partidas] [territorios] [politicas]
+    //   ./war --turnos [partidas] [territorios] [politicas]
+    //   ./war --benchmark [json|csv] [max_territorios]
+    //   ./war --replay arquivo [repeticoes]
+    //   ./war --servidor endereco [max_sessoes]
+    //   ./war --carga endereco [conexoes] [requisicoes]
+    if (argc > 1 && strcmp(argv[1], "--simular") == 0) {
+        int max_ataque = argumentoPosicional(argc, argv, 2) ? atoi(argv[2]) : SIM_MAX_TROPAS_PADRAO;
+        int max_defesa = argumentoPosicional(argc, argv, 3) ? atoi(argv[3]) : SIM_MAX_TROPAS_PADRAO;
+        long batalhas = argumentoPosicional(argc, argv, 4) ? atol(argv[4]) : SIM_BATALHAS_PADRAO;
+        return executarSimulacao(max_ataque, max_defesa, batalhas, semente, num_threads);
+    }
+    if (argc > 1 && strcmp(argv[1], "--simular-partidas") == 0) {
+        long partidas = argumentoPosicional(argc, argv, 2) ? atol(argv[2]) : SIM_PARTIDAS_PADRAO;
+        int territorios = argumentoPosicional(argc, argv, 3) ? atoi(argv[3]) : SIM_TERRITORIOS_PADRAO;
+        int cores = argumentoPosicional(argc, argv, 4) ? atoi(argv[4]) : SIM_CORES_PADRAO;
+        return executarSimulacaoPartidas(partidas, territorios, cores, semente, num_threads);
+    }
+    if (argc > 1 && strcmp(argv[1], "--probabilidades") == 0) {
+        int max_ataque = argumentoPosicional(argc, argv, 2) ? atoi(argv[2]) : SIM_MAX_TROPAS_PADRAO;
+        int max_defesa = argumentoPosicional(argc, argv, 3) ? atoi(argv[3]) : SIM_MAX_TROPAS_PADRAO;
+        return executarProbabilidades(max_ataque, max_defesa);
+    }
+    if (argc > 1 && strcmp(argv[1], "--bots") == 0) {
+        long partidas = argumentoPosicional(argc, argv, 2) ? atol(argv[2]) : BOTS_PARTIDAS_PADRAO;
+        int territorios = argumentoPosicional(argc, argv, 3) ? atoi(argv[3]) : SIM_TERRITORIOS_PADRAO;
+        const char* politicas = argumentoPosicional(argc, argv, 4) ? argv[4] : BOTS_POLITICAS_PADRAO;
+        return executarPartidasBots(partidas, territorios, politicas, tempo_jogada, max_rollouts, semente, num_threads);
+    }
+    if (argc > 1 && strcmp(argv[1], "--turnos") == 0) {
+        long partidas = argumentoPosicional(argc, argv, 2) ? atol(argv[2]) : TURNOS_PARTIDAS_PADRAO;
+        int territorios = argumentoPosicional(argc, argv, 3) ? atoi(argv[3]) : SIM_TERRITORIOS_PADRAO;
+        const char* politicas = argumentoPosicional(argc, argv, 4) ? argv[4] : TURNOS_POLITICAS_PADRAO;
+        return executarPartidasTurnos(partidas, territorios, politicas, tempo_jogada, max_rollouts, semente, num_threads);
+    }
+    if (argc > 1 && strcmp(argv[1], "--benchmark") == 0) {
+        const char* formato = argumentoPosicional(argc, argv, 2) ? argv[2] : "json";
+        int max_territorios = argumentoPosicional(argc, argv, 3) ? atoi(argv[3]) : BENCH_MAX_TERRITORIOS_PADRAO;
+        return executarBenchmarks(formato, max_territorios, semente);
+    }
+    if (argc > 2 && strcmp(argv[1], "--replay") == 0) {
+        long repeticoes = argumentoPosicional(argc, argv, 3) ? atol(argv[3]) : REPLAY_REPETICOES_PADRAO;
+        return executarReplay(argv[2], repeticoes);
+    }
+    if (argc > 2 && strcmp(argv[1], "--servidor") == 0) {
+        int max_sessoes = argumentoPosicional(argc, argv, 3) ? atoi(argv[3]) : SERVIDOR_SESSOES_PADRAO;
+        return executarServidor(argv[2], max_sessoes, semente);
+    }
+    if (argc > 2 && strcmp(argv[1], "--carga") == 0) {
+        int conexoes = argumentoPosicional(argc, argv, 3) ? atoi(argv[3]) : CARGA_CONEXOES_PADRAO;
+        long requisicoes = argumentoPosicional(argc, argv, 4) ? atol(argv[4]) : CARGA_REQUISICOES_PADRAO;
+        return executarCarga(argv[2], conexoes, requisicoes, semente);
     }
 
-    // Inicia o Ataque
-    atacar(atacante, defensor);
+    // Instrumentação da sessão interativa: resumo na saída e, com --trace, um
+    // arquivo no formato Trace Event. Os modos acima rodam em várias threads e
+    // não são instrumentados.
+    if ((instrumentar || arquivo_trace != NULL) && iniciarInstrumentacao(arquivo_trace) != 0) {
+        perror("Erro ao criar o arquivo de trace");
+        return EXIT_FAILURE;
+    }
+    // Registro da partida (--gravar): reproduzível depois com --replay.
+    if (arquivo_registro != NULL && iniciarRegistro(arquivo_registro, semente) != 0) {
+        perror("Erro ao criar o registro da partida");
+        encerrarInstrumentacao();
+        return EXIT_FAILURE;
+    }
 
-    // Exibição pós-ataque
-    printf("\n--- Dados atualizados pós-ataque ---\n");
-    printf("Atacante:\n Nome: %s, Cor: %s, Tropas: %d\n", atacante->nome, atacante->cor, atacante->tropas);
-    printf("Defensor:\n Nome: %s, Cor: %s, Tropas: %d\n", defensor->nome, defensor->cor, defensor->tropas);
+    GeradorAleatorio gerador;
+    iniciarGerador(&gerador, semente, 0);
+    
+    const DefinicaoMissao* missoes = MISSOES_MENU;
+    int total_missoes = TOTAL_MISSOES_MENU;
 
-    // VERIFICAÇÃO DE MISSÃO (NOVA FUNCIONALIDADE)
-    if (verificarMissao(missao_do_jogador, mapa, total_territorios)) {
-        *jogo_vencido = 1; // Altera a flag de vitória por referência
-    }
-}
+    Mapa* mapa = NULL;
+    int opcao;
 
+    // Relato das batalhas: montado em um buffer reutilizado a cada ataque; no
+    // modo --silencioso (útil com entrada roteirizada) nada é relatado.
+    SaidaBuffer saida_batalhas;
+    iniciarSaida(&saida_batalhas, stdout);
+    SaidaBuffer* relatorio = silencioso ? NULL : &saida_batalhas;
+    int jogo_vencido = 0; // Flag para condição de vitória
 
-// --- Função Principal (Main) ---
+    // Toda a memória da partida (mapa, missão) vem desta arena
+    Arena arena;
+    iniciarArena(&arena);
 
-int main() {
-    srand(time(NULL)); 
-    
-    // Missões pré-definidas (vetor de strings constantes)
-    const char* missoes[] = {
-        "Conquistar 3 territórios seguidos.",
-        "Eliminar todas as tropas da cor Vermelho do mapa.",
-        "Ter mais de 10 tropas no total no final do turno.",
-        "Possuir o território chamado 'Brasil'.",
-        "Ter mais territórios do que qualquer outra cor."
-    };
-    int total_missoes = sizeof(missoes) / sizeof(missoes[0]);
-    
     // Variável para a missão (ALOCADA DINAMICAMENTE)
-    char* missao_do_jogador = (char*)malloc(MAX_MISSAO * sizeof(char));
+    Missao* missao_do_jogador = (Missao*)arenaAlocar(&arena, sizeof(Missao));
     if (missao_do_jogador == NULL) {
         perror("Erro na alocação da missão");
         return EXIT_FAILURE;
     }
 
-    // Atribuição da Missão (Passagem por Referência)
-    atribuirMissao(missao_do_jogador, missoes, total_missoes);
-    exibirMissao(missao_do_jogador); // Exibe apenas uma vez (Passagem por Valor)
+    if (arquivo_snapshot != NULL) {
+        // Retomada de um jogo salvo: mapa, missão e gerador vêm do arquivo.
+        double inicio = tempoAtualSegundos();
+        mapa = carregarSnapshot(arquivo_snapshot, &arena, missao_do_jogador, &gerador);
+        if (mapa == NULL || missao_do_jogador->indice < 0 || missao_do_jogador->indice >= total_missoes) {
+            fprintf(stderr, "Snapshot inválido ou ilegível: %s\n", arquivo_snapshot);
+            encerrarRegistro(NULL, NULL, NULL);
+            encerrarInstrumentacao();
+            liberarMemoria(mapa, &arena);
+            return EXIT_FAILURE;
+        }
+        missao_do_jogador->descricao = missoes[missao_do_jogador->indice].descricao;
+        printf("Jogo carregado de '%s' (%d territórios, %.2f ms).\n", arquivo_snapshot, mapa->total,
+               (tempoAtualSegundos() - inicio) * 1000.0);
+    } else if (arquivo_cenario != NULL) {
+        // Cenário CSV: o mapa cresce conforme as linhas são lidas, sem perguntar a capacidade.
+        EstatisticasImportacao estatisticas;
+        mapa = criarMapa(&arena, CAPACIDADE_INICIAL);
+        if (mapa == NULL || importarCenario(arquivo_cenario, mapa, &estatisticas) != 0) {
+            perror("Erro ao importar o cenário");
+            encerrarRegistro(NULL, NULL, NULL);
+            encerrarInstrumentacao();
+            liberarMemoria(mapa, &arena);
+            return EXIT_FAILURE;
+        }
+        printf("Cenário '%s': %ld territórios e %ld fronteiras importados de %ld linhas (%ld com erro) em %.2f ms",
+               arquivo_cenario, estatisticas.importados, estatisticas.fronteiras, estatisticas.linhas,
+               estatisticas.erros, estatisticas.segundos * 1000.0);
+        if (estatisticas.segundos > 0) {
+            printf(" - %.0f linhas/s, %.1f MB/s", estatisticas.linhas / estatisticas.segundos,
+                   estatisticas.bytes / estatisticas.segundos / 1e6);
+        }
+        printf(".\n");
 
-    Territorio* mapa = NULL;
-    int max_territorios = 0;
-    int total_territorios = 0;
-    int opcao;
-    int jogo_vencido = 0; // Flag para condição de vitória
+        atribuirMissao(missao_do_jogador, missoes, total_missoes, mapa, -1, &gerador);
+    } else {
+        // Alocação Dinâmica do Mapa (antes da missão, que resolve suas cores nele)
+        mapa = alocarMapa(&arena);
 
-    // Alocação Dinâmica do Mapa
-    mapa = alocarMapa(&max_territorios);
+        // Atribuição da Missão (Passagem por Referência)
+        atribuirMissao(missao_do_jogador, missoes, total_missoes, mapa, -1, &gerador);
+    }
+    exibirMissao(missao_do_jogador); // Exibe apenas uma vez (Passagem por Valor)
+    registrarEstadoInicial(mapa, missao_do_jogador, &gerador);
 
     do {
         printf("\n=================================================\n");
@@ -476,6 +6668,10 @@ int main() {
         printf("1 - Para cadastrar um Território/Tropa\n");
         printf("2 - Exibir Territórios/Tropas\n");
         printf("3 - INICIAR ATAQUE ENTRE TERRITÓRIOS\n"); 
+        printf("4 - Salvar jogo\n");
+        printf("5 - Cadastrar fronteira entre territórios\n");
+        printf("6 - Exibir regiões por cor\n");
+        printf("7 - Consultar territórios (tabela com filtros)\n");
         printf("=================================================\n");
         printf("Escolha uma opção: ");
         
@@ -487,15 +6683,37 @@ int main() {
 
         switch(opcao) {
             case 1:
-                cadastrarTerritorio(mapa, max_territorios, &total_territorios);
+                {
+                    int id = cadastrarTerritorio(mapa);
+                    if (id >= 0) {
+                        vincularTerritorioMissao(missao_do_jogador, mapa, id);
+                        registrarTerritorio(mapa, id);
+                    }
+                }
                 break;
 
             case 2: 
-                exibirTerritorios(mapa, total_territorios);
+                exibirTerritorios(mapa);
                 break;
 
             case 3: // Iniciar Ataque
-                iniciarAtaque(mapa, total_territorios, missao_do_jogador, &jogo_vencido);
+                iniciarAtaque(mapa, missao_do_jogador, &jogo_vencido, &gerador, relatorio);
+                break;
+
+            case 4:
+                salvarJogo(mapa, missao_do_jogador, &gerador);
+                break;
+
+            case 5:
+                cadastrarFronteira(mapa);
+                break;
+
+            case 6:
+                exibirRegioes(mapa);
+                break;
+
+            case 7:
+                consultarTerritorios(mapa);
                 break;
 
             case 0:
@@ -511,7 +6729,7 @@ int main() {
         if (jogo_vencido) {
             printf("\n\n*************************************************\n");
             printf("****** PARABÉNS! VOCÊ CUMPRIU SUA MISSÃO! ******\n");
-            printf("****** Missão: %s ******\n", missao_do_jogador);
+            printf("****** Missão: %s ******\n", missao_do_jogador->descricao);
             printf("*************************************************\n");
             opcao = 0; // Força a saída do loop
         }
@@ -523,8 +6741,10 @@ int main() {
 
     } while (opcao != 0);
 
-    // Liberação de TODA a memória alocada
-    liberarMemoria(mapa, missao_do_jogador);
+    // Fim do registro e da instrumentação (se ligados) e liberação de TODA a memória alocada
+    encerrarRegistro(mapa, missao_do_jogador, &gerador);
+    encerrarInstrumentacao();
+    liberarMemoria(mapa, &arena);
 
     return 0;
 }
\ No newline at end of file